@@ -0,0 +1,226 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "SharedMemoryClient.h"
+#include "TestSupport.h"
+
+// Replays a stream of typical server ticks through the client and counts the heap allocations it makes
+// per packet, through a counting operator new. The copying read loop the client used before it decoded packets
+// in place is replayed over the same stream for comparison: it allocated a vector for every packet it read.
+
+namespace
+{
+	std::atomic<uint64_t> g_allocations = 0;
+
+	volatile std::byte g_sink;
+
+	// Only the client's threads are counted, not the producer, unless it runs the copying loop.
+	thread_local bool t_countAllocations = true;
+
+	void *Allocate(const size_t size)
+	{
+		if (t_countAllocations)
+		{
+			g_allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (void *memory = std::malloc(size != 0 ? size : 1))
+			return memory;
+		throw std::bad_alloc();
+	}
+
+	void *AllocateAligned(const size_t size, const std::align_val_t alignment)
+	{
+		if (t_countAllocations)
+		{
+			g_allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		const auto align = static_cast<size_t>(alignment);
+		if (void *memory = std::aligned_alloc(align, (size + align - 1) / align * align))
+			return memory;
+		throw std::bad_alloc();
+	}
+}
+
+void *operator new(const size_t size) { return Allocate(size); }
+void *operator new[](const size_t size) { return Allocate(size); }
+void *operator new(const size_t size, const std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void *operator new[](const size_t size, const std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void  operator delete(void *memory) noexcept { std::free(memory); }
+void  operator delete[](void *memory) noexcept { std::free(memory); }
+void  operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void  operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+void  operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void  operator delete[](void *memory, std::align_val_t) noexcept { std::free(memory); }
+void  operator delete(void *memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void  operator delete[](void *memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+
+namespace
+{
+	struct Packet
+	{
+		PacketType             type;
+		std::vector<std::byte> data;
+	};
+
+	template <typename T>
+	Packet MakePacket(const PacketType type, const T &data)
+	{
+		Packet packet = {type, std::vector<std::byte>(sizeof(T))};
+		memcpy(packet.data.data(), &data, sizeof(T));
+		return packet;
+	}
+
+	Packet MakeCompactPacket(const DrawCommandPacket &command)
+	{
+		Packet packet = {PacketType::DRAW_COMMAND_COMPACT, std::vector<std::byte>(MAX_COMPACT_DRAW_COMMAND_SIZE)};
+		packet.data.resize(EncodeCompactDrawCommand(command, packet.data.data()));
+		return packet;
+	}
+
+	constexpr int    TICK_COUNT     = 2000;
+	constexpr int    WARM_UP_TICKS  = 200;
+	constexpr float  TICK_INTERVAL  = 1.0f / 64.0f;
+	constexpr size_t RETAINED_COUNT = 64;
+
+	// One server tick: the camera, lines and texts that live for a few ticks, a batch of re-sent lines,
+	// and updates to some of the retained objects. Ticks differ in their time, positions and offsets only.
+	void AddTick(std::vector<Packet> &stream, const int tick)
+	{
+		const float time = static_cast<float>(tick) * TICK_INTERVAL;
+		stream.push_back(MakePacket(PacketType::WORLD_UPDATE, WorldUpdatePacket({0, static_cast<float>(tick), 0}, {0, 0, 64}, time)));
+
+		for (int i = 0; i < 200; i++)
+		{
+			const auto x = static_cast<float>(tick * 200 + i);
+			stream.push_back(MakeCompactPacket(DrawCommandPacket(DrawCommandType::LINE, RED, time + 4 * TICK_INTERVAL,
+			                                                     LineCommandData({x, 0, 0}, {x, 10, 0}))));
+		}
+
+		for (int i = 0; i < 20; i++)
+		{
+			std::array<char, 32> label;
+			snprintf(label.data(), label.size(), "player %d", i);
+			stream.push_back(MakeCompactPacket(DrawCommandPacket(DrawCommandType::TEXT, WHITE, time + 4 * TICK_INTERVAL,
+			                                                     TextCommandData({static_cast<float>(tick), static_cast<float>(i), 0}, label.data()))));
+		}
+
+		constexpr uint32_t     LINE_COUNT = 64;
+		const DrawBatchHeader  batch      = {DrawCommandType::LINE, GREEN, time + 4 * TICK_INTERVAL, DrawBatchLayout::LIST, LINE_COUNT};
+		Packet                 packet     = {PacketType::DRAW_BATCH, std::vector<std::byte>(sizeof(batch) + LINE_COUNT * sizeof(LineCommandData))};
+		memcpy(packet.data.data(), &batch, sizeof(batch));
+		for (uint32_t i = 0; i < LINE_COUNT; i++)
+		{
+			const LineCommandData line({static_cast<float>(i), 0, 100}, {static_cast<float>(i), 10, 100});
+			memcpy(packet.data.data() + sizeof(batch) + i * sizeof(line), &line, sizeof(line));
+		}
+		stream.push_back(std::move(packet));
+
+		for (size_t i = tick % 4; i < RETAINED_COUNT; i += 4)
+		{
+			const RetainedUpdateData update = {i, RetainedUpdateField::OFFSET, WHITE, {static_cast<float>(tick), 0, 0}};
+			stream.push_back(MakePacket(PacketType::RETAINED_UPDATE, update));
+		}
+	}
+
+	// The retained objects the ticks update, created once up front.
+	void AddRetainedObjects(std::vector<Packet> &stream)
+	{
+		for (size_t i = 0; i < RETAINED_COUNT; i++)
+		{
+			const auto              x   = static_cast<float>(i);
+			const DrawCommandPacket box = {DrawCommandType::BBOX, BLUE, 0.0f, BBoxCommandData({x, 0, 0}, {x + 1, 1, 1})};
+
+			Packet packet = {PacketType::RETAINED_CREATE, std::vector<std::byte>(sizeof(RetainedCreateHeader) + MAX_COMPACT_DRAW_COMMAND_SIZE)};
+			const RetainedCreateHeader create = {i};
+			memcpy(packet.data.data(), &create, sizeof(create));
+			packet.data.resize(sizeof(create) + EncodeCompactDrawCommand(box, packet.data.data() + sizeof(create)));
+			stream.push_back(std::move(packet));
+		}
+	}
+
+	// Sends the packets and returns how many allocations the client made while it handled them.
+	uint64_t Replay(TestServer &server, const std::vector<Packet> &stream, const size_t first, const size_t last)
+	{
+		const uint64_t before = g_allocations.load();
+		for (size_t i = first; i < last; i++)
+		{
+			server.Send(stream[i].type, stream[i].data.data(), static_cast<uint32_t>(stream[i].data.size()));
+			if (stream[i].type == PacketType::WORLD_UPDATE)
+			{
+				server.Signal();
+			}
+		}
+		CHECK(server.WaitUntilDrained());
+
+		// The worker publishes a snapshot after it released the ring, give it time to finish.
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		return g_allocations.load() - before;
+	}
+
+	// What the read loop did before decoding in place: a fresh vector per packet, the payload copied into it.
+	uint64_t ReplayCopying(const std::vector<Packet> &stream, const size_t first, const size_t last)
+	{
+		t_countAllocations = true;
+		const uint64_t before = g_allocations.load();
+
+		for (size_t i = first; i < last; i++)
+		{
+			std::vector<std::byte> dataBuffer(stream[i].data.size());
+			memcpy(dataBuffer.data(), stream[i].data.data(), dataBuffer.size());
+			g_sink = dataBuffer.back(); // Keeps the copy from being optimized away
+		}
+
+		const uint64_t allocations = g_allocations.load() - before;
+		t_countAllocations         = false;
+		return allocations;
+	}
+}
+
+int main()
+{
+	t_countAllocations = false;
+
+	std::vector<Packet> stream;
+	size_t              warmUpEnd = 0; // The first packet of the first tick after the warm-up
+	AddRetainedObjects(stream);
+	for (int tick = 0; tick < TICK_COUNT; tick++)
+	{
+		if (tick == WARM_UP_TICKS)
+		{
+			warmUpEnd = stream.size();
+		}
+		AddTick(stream, tick);
+	}
+
+	// The client logs its connection and wait statistics to std::cout, keep them out of the results.
+	std::streambuf *log = std::cout.rdbuf(nullptr);
+
+	TestServer         server(SHARED_MEM_BUFFER_SIZE);
+	std::atomic<bool>  running = true;
+	SharedMemoryClient client;
+	CHECK(client.Start(running));
+
+	const uint64_t warmUp = Replay(server, stream, 0, warmUpEnd);
+	const uint64_t steady = Replay(server, stream, warmUpEnd, stream.size());
+	client.Stop();
+	std::cout.rdbuf(log);
+
+	const uint64_t copying     = ReplayCopying(stream, warmUpEnd, stream.size());
+	const size_t   steadyCount = stream.size() - warmUpEnd;
+	std::printf("Warm-up: %d ticks, %zu packets. Steady state: %d ticks, %zu packets.\n", WARM_UP_TICKS, warmUpEnd, TICK_COUNT - WARM_UP_TICKS,
+	            steadyCount);
+	std::printf("  client, warm-up:                  %8llu allocations, %.4f per packet\n", static_cast<unsigned long long>(warmUp),
+	            static_cast<double>(warmUp) / static_cast<double>(warmUpEnd));
+	std::printf("  client, steady state:             %8llu allocations, %.4f per packet\n", static_cast<unsigned long long>(steady),
+	            static_cast<double>(steady) / static_cast<double>(steadyCount));
+	std::printf("  copying read loop, steady state:  %8llu allocations, %.4f per packet, on top of the client's\n",
+	            static_cast<unsigned long long>(copying), static_cast<double>(copying) / static_cast<double>(steadyCount));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "Raylib/raylib.h"
+#include "Raylib/raymath.h"
+#include "Raylib/rlgl.h"
+#include "ScreenProjector.h"
+#include "TestSupport.h"
+
+// Projects 1k and 10k world text anchors per frame, with ScreenProjector and the per-label GetWorldToScreen
+// loop the renderer used before it, and reports the time per frame of each.
+
+namespace
+{
+	constexpr int SCREEN_WIDTH  = 1920;
+	constexpr int SCREEN_HEIGHT = 1080;
+
+	// raylib's GetWorldToScreenEx for a perspective camera, as core.c implements it. The benchmark does not link
+	// raylib, which would need a window for GetWorldToScreen's screen size, so it is repeated here over raymath.
+	Vector2 GetWorldToScreenReference(const Vector3 position, const Camera3D &camera, const int width, const int height)
+	{
+		const Matrix matProj = MatrixPerspective(camera.fovy * DEG2RAD, static_cast<double>(width) / static_cast<double>(height),
+		                                         RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+		const Matrix matView = MatrixLookAt(camera.position, camera.target, camera.up);
+
+		Quaternion worldPos = {position.x, position.y, position.z, 1.0f};
+		worldPos            = QuaternionTransform(worldPos, matView);
+		worldPos            = QuaternionTransform(worldPos, matProj);
+
+		const Vector3 ndcPos = {worldPos.x / worldPos.w, -worldPos.y / worldPos.w, worldPos.z / worldPos.w};
+		return {(ndcPos.x + 1.0f) / 2.0f * static_cast<float>(width), (ndcPos.y + 1.0f) / 2.0f * static_cast<float>(height)};
+	}
+
+	// The loop Render2DCommands ran before ScreenProjector: GetWorldToScreen, then the on screen and in front tests.
+	void ProjectPerLabel(const Camera3D &camera, const std::vector<Vector3> &positions, ProjectedPoints &out)
+	{
+		out.Clear();
+		const Vector3 camForward = Vector3Subtract(camera.target, camera.position);
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			const Vector2 screenPos = GetWorldToScreenReference(positions[i], camera, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+			const bool onScreen = (screenPos.x >= 0) && (screenPos.x < static_cast<float>(SCREEN_WIDTH)) &&
+			                      (screenPos.y >= 0) && (screenPos.y < static_cast<float>(SCREEN_HEIGHT));
+
+			const Vector3 toPoint = Vector3Subtract(positions[i], camera.position);
+			const bool    inFront = Vector3DotProduct(camForward, toPoint) > 0;
+
+			if (!onScreen || !inFront)
+				continue;
+
+			out.indices.push_back(static_cast<uint32_t>(i));
+			out.positions.push_back(screenPos);
+		}
+	}
+
+	// Best time per frame over a few runs, in microseconds.
+	double TimeFrame(const std::function<void()> &frame)
+	{
+		constexpr int RUN_COUNT   = 7;
+		constexpr int FRAME_COUNT = 200;
+
+		double best = INFINITY;
+		for (int run = 0; run < RUN_COUNT; run++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < FRAME_COUNT; i++)
+			{
+				frame();
+			}
+			best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / FRAME_COUNT);
+		}
+		return best;
+	}
+
+	void Run(const size_t labelCount)
+	{
+		const Camera3D camera = {{100, 50, -30}, {120, 40, 10}, {0, 1, 0}, 75, CAMERA_PERSPECTIVE};
+
+		std::mt19937                          random(static_cast<uint32_t>(labelCount));
+		std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+		std::vector<Vector3>                  positions(labelCount);
+		for (Vector3 &position : positions)
+		{
+			position = {coordinate(random), coordinate(random), coordinate(random)};
+		}
+
+		ProjectedPoints perLabel, scalar, batch;
+		ProjectPerLabel(camera, positions, perLabel);
+
+		// Built once per frame, as the renderer does.
+		auto projectBatch = [&](ProjectedPoints &out, const bool simd)
+		{
+			const ScreenProjector projector(camera, SCREEN_WIDTH, SCREEN_HEIGHT);
+			if (simd)
+				projector.Project(positions, out);
+			else
+				projector.ProjectScalar(positions, out);
+		};
+		projectBatch(scalar, false);
+		projectBatch(batch, true);
+
+		// Same labels, at the same place up to rounding, before any of them is timed.
+		CHECK(batch.indices == scalar.indices && batch.indices == perLabel.indices);
+		for (size_t i = 0; i < batch.GetCount(); i++)
+		{
+			CHECK(std::fabs(batch.positions[i].x - perLabel.positions[i].x) < 0.05f && std::fabs(batch.positions[i].y - perLabel.positions[i].y) < 0.05f);
+		}
+
+		const double perLabelTime = TimeFrame([&] { ProjectPerLabel(camera, positions, perLabel); });
+		const double scalarTime   = TimeFrame([&] { projectBatch(scalar, false); });
+		const double batchTime    = TimeFrame([&] { projectBatch(batch, true); });
+
+		std::printf("%6zu labels, %5zu visible: GetWorldToScreen per label %8.2f us, batch scalar %8.2f us (%4.1fx), batch SSE %8.2f us (%4.1fx)\n",
+		            labelCount, batch.GetCount(), perLabelTime, scalarTime, perLabelTime / scalarTime, batchTime, perLabelTime / batchTime);
+	}
+}
+
+int main()
+{
+	Run(1000);
+	Run(10000);
+	return EXIT_SUCCESS;
+}
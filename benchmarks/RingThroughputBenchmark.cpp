@@ -0,0 +1,182 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "SharedMemoryClient.h"
+#include "TestSupport.h"
+
+// Streams packets from a producer thread through the ring to the client's worker thread, each pinned to its own core,
+// and reports how fast the worker drains them, once with the tail published after every packet and once every
+// Config::TAIL_PUBLISH_BYTES, side by side. The worker is started from a thread pinned to the consumer core,
+// so it inherits that affinity without the client having to expose its thread.
+
+namespace
+{
+	// The CPUs this process may run on, in order.
+	std::vector<int> GetAvailableCpus()
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		std::vector<int> cpus;
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (CPU_ISSET(cpu, &set))
+				{
+					cpus.push_back(cpu);
+				}
+			}
+		}
+		return cpus;
+	}
+
+	bool PinCurrentThread(const int cpu)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+
+	struct Packet
+	{
+		PacketType             type;
+		std::vector<std::byte> data;
+	};
+
+	// The packets are sent in order, over and over, until count packets went through the ring.
+	struct Workload
+	{
+		const char         *name;
+		std::vector<Packet> packets;
+		size_t              count;
+	};
+
+	Workload MakeChannelWorkload()
+	{
+		const SetChannelData channel = {1};
+		std::vector<std::byte> data(sizeof(channel));
+		memcpy(data.data(), &channel, sizeof(channel));
+		return {"SET_CHANNEL", {{PacketType::SET_CHANNEL, std::move(data)}}, 4'000'000};
+	}
+
+	// Batches of lines that are all different, so every line takes a slot of its own instead of being deduplicated
+	// into the one it repeats. A CLEAR_ALL_DRAWINGS after the last batch empties the store before it fills up.
+	Workload MakeBatchWorkload()
+	{
+		constexpr uint32_t LINE_COUNT  = 64;
+		constexpr uint32_t BATCH_COUNT = Config::MAX_DRAW_COMMANDS / LINE_COUNT;
+
+		std::vector<Packet> packets;
+		for (uint32_t batchIndex = 0; batchIndex < BATCH_COUNT; batchIndex++)
+		{
+			const DrawBatchHeader batch = {DrawCommandType::LINE, RED, 100.0f, DrawBatchLayout::LIST, LINE_COUNT};
+			std::vector<std::byte> data(sizeof(batch) + LINE_COUNT * sizeof(LineCommandData));
+			memcpy(data.data(), &batch, sizeof(batch));
+			for (uint32_t i = 0; i < LINE_COUNT; i++)
+			{
+				const auto            x = static_cast<float>(batchIndex * LINE_COUNT + i);
+				const LineCommandData line({x, 0, 0}, {x, 1, 1});
+				memcpy(data.data() + sizeof(batch) + i * sizeof(line), &line, sizeof(line));
+			}
+			packets.push_back({PacketType::DRAW_BATCH, std::move(data)});
+		}
+		packets.push_back({PacketType::CLEAR_ALL_DRAWINGS, {}});
+		return {"distinct DRAW_BATCH of 64 lines", std::move(packets), 200'000};
+	}
+
+	struct Result
+	{
+		double seconds;
+		size_t bytes;
+	};
+
+	// Streams the workload through a client that publishes its tail every tailPublishBytes consumed bytes.
+	Result Run(const Workload &workload, const size_t tailPublishBytes, const std::vector<int> &cpus)
+	{
+		TestServer server(SHARED_MEM_BUFFER_SIZE);
+
+		// The worker thread inherits the affinity of the thread that starts it.
+		const bool pinned = cpus.size() >= 2 && PinCurrentThread(cpus[1]);
+
+		std::atomic<bool>  running = true;
+		SharedMemoryClient client;
+		client.SetTailPublishBytes(tailPublishBytes);
+		CHECK(client.Start(running));
+
+		if (pinned)
+		{
+			CHECK(PinCurrentThread(cpus[0]));
+		}
+
+		const size_t headerSize = (server.GetLayout().features & SharedMemFeature::CHECKED_FRAMING) != 0 ? sizeof(FramedPacketHeader) : sizeof(PacketHeader);
+		size_t       bytes      = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < workload.count; i++)
+		{
+			const Packet &packet = workload.packets[i % workload.packets.size()];
+			server.Send(packet.type, packet.data.data(), static_cast<uint32_t>(packet.data.size()));
+			bytes += headerSize + packet.data.size();
+			if (i % 64 == 0)
+			{
+				server.Signal();
+			}
+		}
+		CHECK(server.WaitUntilDrained());
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		client.Stop();
+		return {seconds, bytes};
+	}
+
+	// One row of the table, with the speedup over publishing the tail after every packet.
+	void PrintResult(const char *mode, const size_t count, const Result &result, const Result &perPacket)
+	{
+		std::printf("  %-34s %7.3f s  %8.2f M packets/s  %8.1f MB/s  %5.2fx\n", mode, result.seconds, static_cast<double>(count) / result.seconds / 1e6,
+		            static_cast<double>(result.bytes) / result.seconds / (1024.0 * 1024.0), perPacket.seconds / result.seconds);
+	}
+}
+
+int main()
+{
+	const std::vector<int> cpus = GetAvailableCpus();
+	if (cpus.size() >= 2)
+	{
+		std::printf("Producer pinned to CPU %d, client worker pinned to CPU %d.\n", cpus[0], cpus[1]);
+	}
+	else
+	{
+		std::printf("Only %zu CPU available, producer and client worker share it unpinned.\n", cpus.size());
+	}
+
+	// The client logs its connection and wait statistics to std::cout, keep them out of the table.
+	std::streambuf *log = std::cout.rdbuf(nullptr);
+
+	std::array<char, 64> batchedMode;
+	snprintf(batchedMode.data(), batchedMode.size(), "tail published every %zu KB", Config::TAIL_PUBLISH_BYTES / 1024);
+
+	// The table is printed as it goes, so the log is only silenced while a client runs.
+	const std::vector<Workload> workloads = {MakeChannelWorkload(), MakeBatchWorkload()};
+	for (const Workload &workload : workloads)
+	{
+		const Result perPacket = Run(workload, 0, cpus);
+		const Result batched   = Run(workload, Config::TAIL_PUBLISH_BYTES, cpus);
+
+		std::cout.rdbuf(log);
+		std::printf("%s, %zu packets:\n", workload.name, workload.count);
+		PrintResult("tail published after every packet", workload.count, perPacket, perPacket);
+		PrintResult(batchedMode.data(), workload.count, batched, perPacket);
+		std::cout.rdbuf(nullptr);
+	}
+
+	std::cout.rdbuf(log);
+	return EXIT_SUCCESS;
+}
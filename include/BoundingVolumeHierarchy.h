@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "DrawList.h"
+#include "FrustumCuller.h"
+#include "Raylib/raylib.h"
+
+// A dynamic bounding volume hierarchy: a binary tree of axis aligned boxes whose leaves are inserted,
+// moved and removed one at a time. A change only refits the boxes on the path to the root, rotating
+// the nodes there to keep the tree balanced, so it costs O(log n) however many leaves there are.
+// Queries only descend into the boxes they touch. Each leaf carries a payload its owner chooses.
+// Copies share their nodes until either one changes them, so a copy costs O(n / CHUNK_SIZE)
+// and a change afterwards only copies the chunks of nodes it touches.
+class BoundingVolumeHierarchy
+{
+public:
+	static constexpr int32_t NULL_NODE = -1;
+
+	struct RaycastHit
+	{
+		int32_t  leaf;
+		uint32_t payload;
+		float    distance; // Along the ray
+	};
+
+	// Adds a leaf. Returns its node, which stays the same until the leaf is removed.
+	int32_t Insert(const BoundingBox &box, uint32_t payload);
+
+	void Remove(int32_t leaf);
+
+	// Changes the box of a leaf, moving it to where it now fits best.
+	void Move(int32_t leaf, const BoundingBox &box);
+
+	void SetPayload(const int32_t leaf, const uint32_t payload) { EditNode(leaf).payload = payload; }
+
+	void Clear();
+
+	// Appends the payloads of the leaves whose box is at least partly inside the frustum, in no particular order.
+	void QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &payloads) const;
+
+	// Finds the nearest leaf the ray hits; its direction must be unit length, as for raylib's ray tests.
+	// Boxes are grown by margin on every side for the test, then hitTest(payload) gives the distance at which
+	// the leaf is really hit, or nullopt if it is not. Nearer boxes are visited first, and boxes further away
+	// than the nearest hit so far are skipped.
+	template <typename THitTest>
+	std::optional<RaycastHit> Raycast(const Ray &ray, float margin, THitTest hitTest) const;
+
+	[[nodiscard]] const BoundingBox &GetBox(const int32_t node) const { return GetNode(node).box; }
+
+	[[nodiscard]] size_t GetLeafCount() const { return m_leafCount; }
+	[[nodiscard]] int    GetHeight() const { return m_root != NULL_NODE ? GetNode(m_root).height : 0; }
+
+private:
+	struct Node
+	{
+		BoundingBox box;
+		int32_t     parent  = NULL_NODE; // The next free node while on the free list
+		int32_t     child1  = NULL_NODE;
+		int32_t     child2  = NULL_NODE;
+		int32_t     height  = 0;         // 0 for leaves, -1 on the free list
+		uint32_t    payload = 0;
+
+		[[nodiscard]] bool IsLeaf() const { return child1 == NULL_NODE; }
+	};
+
+	static constexpr size_t CHUNK_SIZE = 256;
+	using Chunk                        = std::array<Node, CHUNK_SIZE>;
+
+	[[nodiscard]] const Node &GetNode(const int32_t node) const { return (*m_chunks[node / CHUNK_SIZE])[node % CHUNK_SIZE]; }
+
+	// The node, in a chunk of this tree only. Do not hold on to a reference from GetNode across this.
+	Node &EditNode(int32_t node);
+
+	int32_t AllocateNode();
+	void    FreeNode(int32_t node);
+	void    InsertLeaf(int32_t leaf);
+	void    RemoveLeaf(int32_t leaf);
+	void    Refit(int32_t node);
+	int32_t Balance(int32_t node);
+
+	void QueryNode(int32_t node, const Frustum &frustum, bool inside, std::vector<uint32_t> &payloads) const;
+
+	template <typename THitTest>
+	void RaycastNode(int32_t node, const Ray &ray, float margin, THitTest &hitTest, std::optional<RaycastHit> &nearest) const;
+
+	// Distance along the ray at which it enters the box grown by margin, or infinity if it misses.
+	static float GetEntryDistance(const BoundingBox &box, const Ray &ray, float margin);
+
+	std::vector<std::shared_ptr<Chunk>> m_chunks;
+	size_t                              m_nodeCount = 0; // Nodes handed out so far, including the ones on the free list
+	int32_t                             m_root      = NULL_NODE;
+	int32_t                             m_freeList  = NULL_NODE;
+	size_t                              m_leafCount = 0;
+};
+
+template <typename THitTest>
+std::optional<BoundingVolumeHierarchy::RaycastHit> BoundingVolumeHierarchy::Raycast(const Ray &ray, const float margin, THitTest hitTest) const
+{
+	std::optional<RaycastHit> nearest;
+	if (m_root != NULL_NODE && GetEntryDistance(GetNode(m_root).box, ray, margin) < INFINITY)
+	{
+		RaycastNode(m_root, ray, margin, hitTest, nearest);
+	}
+	return nearest;
+}
+
+template <typename THitTest>
+void BoundingVolumeHierarchy::RaycastNode(const int32_t node, const Ray &ray, const float margin, THitTest &hitTest,
+                                          std::optional<RaycastHit> &nearest) const
+{
+	const Node &current = GetNode(node);
+	if (current.IsLeaf())
+	{
+		const std::optional<float> distance = hitTest(current.payload);
+		if (distance && (!nearest || *distance < nearest->distance))
+		{
+			nearest = RaycastHit{node, current.payload, *distance};
+		}
+		return;
+	}
+
+	// Nearer child first, it may leave nothing to look for in the other one.
+	int32_t first          = current.child1;
+	int32_t second         = current.child2;
+	float   firstDistance  = GetEntryDistance(GetNode(first).box, ray, margin);
+	float   secondDistance = GetEntryDistance(GetNode(second).box, ray, margin);
+	if (secondDistance < firstDistance)
+	{
+		std::swap(first, second);
+		std::swap(firstDistance, secondDistance);
+	}
+
+	if (firstDistance < INFINITY && (!nearest || firstDistance <= nearest->distance))
+	{
+		RaycastNode(first, ray, margin, hitTest, nearest);
+	}
+	if (secondDistance < INFINITY && (!nearest || secondDistance <= nearest->distance))
+	{
+		RaycastNode(second, ray, margin, hitTest, nearest);
+	}
+}
+
+// A hierarchy over the primitives of one draw list, published along with it. The leaf payloads index
+// primitives, which holds the primitive each leaf stands for, or nothing if it was left out of the list.
+struct PrimitiveHierarchy
+{
+	struct Hit
+	{
+		PrimitiveRef primitive;
+		int32_t      leaf;
+		float        distance;
+	};
+
+	BoundingVolumeHierarchy tree;
+
+	// Shared by the hierarchies published for the same objects, as it only changes when they are created or destroyed.
+	std::shared_ptr<const std::vector<std::optional<PrimitiveRef>>> primitives;
+
+	// The nearest primitive of the list the ray hits, e.g. the one under the crosshair for rlFPCameraGetViewRay.
+	// Lines, which have no area, count as hit when they pass within Config::PICK_LINE_DISTANCE of the ray.
+	[[nodiscard]] std::optional<Hit> Raycast(const DrawList &list, const Ray &ray) const;
+};
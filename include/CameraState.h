@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "SharedDefs.h"
+#include "Raylib/raylib.h"
+
+// Camera position and rlFPCamera view angles (radians) in raylib space.
+struct CameraPose
+{
+	Vector3 position;
+	Vector2 viewAngles;
+};
+
+// The two latest WORLD_UPDATEs, from which the render thread derives the camera pose for the present time.
+// World updates arrive at the server tick rate, well below the frame rate, so showing the latest one as is
+// makes the overlay stutter against the game.
+class CameraState
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Records a world update received at the given time. A curtime going backwards drops the history.
+	void Push(const WorldUpdatePacket &update, Clock::time_point receivedAt);
+
+	// Pose at the given time. Interpolates between the two updates, trailing the latest one by a tick,
+	// or extrapolates past the latest one to predict the present.
+	[[nodiscard]] CameraPose GetPose(Clock::time_point now, bool extrapolate) const;
+
+	[[nodiscard]] bool IsValid() const { return m_count > 0; }
+
+private:
+	struct Sample
+	{
+		QAngle            viewAngles;
+		Vector            origin;
+		float             curtime;
+		Clock::time_point receivedAt;
+	};
+
+	Sample  m_previous{};
+	Sample  m_latest{};
+	uint8_t m_count = 0; // Valid samples, m_latest first
+};
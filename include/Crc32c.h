@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli), using the SSE4.2 crc32 instruction when the CPU has it.
+// Chains like zlib's crc32: pass the previous result as `crc` to continue a checksum over more data.
+uint32_t ComputeCrc32c(const void *data, size_t size, uint32_t crc = 0);
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SharedDefs.h"
+
+// Fixed-capacity storage for the active draw commands.
+// Commands live in a preallocated slab of slots, threaded on an intrusive list in insertion order,
+// so inserting, evicting the oldest command and removing any command by its slot are all O(1)
+// and never move the other commands. Once full, inserting evicts the oldest command.
+//
+// Every command also sits on the intrusive list of its channel, so a channel is cleared in
+// O(commands in that channel).
+//
+// Expiry is indexed by end time: timed commands go on a min-heap keyed on drawEndTime, one-frame
+// commands (drawEndTime <= 0) on a transient list. Removing a command does not touch the heap,
+// its entry is recognized as stale by the slot generation and dropped when it surfaces.
+//
+// Optionally, timed commands are indexed by a hash of their content (channel, type, color and geometry).
+// Inserting a command identical to a stored one then only extends the end time of the stored one,
+// so a server re-sending the same scene every tick does not fill the store with copies.
+// The index is an open addressing table allocated once, so inserting and expiring never allocate.
+class DrawCommandStore
+{
+public:
+	using SlotIndex = uint32_t;
+
+	static constexpr SlotIndex INVALID_SLOT = UINT32_MAX;
+
+	// capacity must be at least 1 and below INVALID_SLOT.
+	DrawCommandStore(size_t capacity, bool deduplicate);
+
+	// Adds a command to the given channel, evicting the oldest one if the store is full.
+	// If deduplicating and an identical timed command is stored, extends that one instead.
+	// Returns the slot holding the command.
+	SlotIndex Insert(uint8_t channel, const DrawCommandPacket &cmd);
+
+	// Adds makeCommand(i) for every i below count to the given channel, in order, as that many Insert calls would.
+	// The slots the batch needs are freed at once, evicting the oldest commands up front, and the expiry of the
+	// whole batch is indexed together. Unlike separate inserts, commands the batch repeats are never evicted
+	// to make room for the rest of it. count must not exceed the capacity.
+	template <typename MakeCommand>
+	void InsertBatch(const uint8_t channel, const size_t count, MakeCommand makeCommand)
+	{
+		m_batchPending.clear();
+		size_t newCount = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (m_batchPending.emplace_back(FindBatchDuplicate(channel, makeCommand(i))).slot == INVALID_SLOT)
+			{
+				newCount++;
+			}
+		}
+
+		ReserveSlots(newCount);
+		for (size_t i = 0; i < count; i++)
+		{
+			AddBatchCommand(channel, makeCommand(i), m_batchPending[i]);
+		}
+		TrackBatchExpiry();
+	}
+
+	// Removes the command in an occupied slot.
+	void Remove(SlotIndex slot);
+
+	// Removes every command in the channel. Returns the number removed.
+	size_t RemoveChannel(uint8_t channel);
+
+	// Removes the one-frame commands and every command whose end time has been reached.
+	// Only touches the commands that expire. Returns the number removed.
+	size_t RemoveExpired(float currentTime);
+
+	void Clear();
+
+	// Calls fn(cmd, slot) for every command, oldest first.
+	template <typename Function>
+	void ForEach(Function fn) const
+	{
+		for (SlotIndex slot = m_oldest; slot != INVALID_SLOT; slot = m_slots[slot].next)
+		{
+			fn(m_slots[slot].cmd, slot);
+		}
+	}
+
+	[[nodiscard]] const DrawCommandPacket &Get(const SlotIndex slot) const { return m_slots[slot].cmd; }
+
+	[[nodiscard]] size_t GetSize() const { return m_size; }
+	[[nodiscard]] size_t GetCapacity() const { return m_capacity; }
+	[[nodiscard]] bool   IsEmpty() const { return m_size == 0; }
+
+	// The hash timed commands are indexed by for deduplication, of their channel, type, color and geometry.
+	[[nodiscard]] static uint32_t HashContent(uint8_t channel, const DrawCommandPacket &cmd);
+
+	// Entries in the expiry heap, the stale ones that were not dropped yet included. Never more than twice the capacity.
+	[[nodiscard]] size_t GetExpiryEntryCount() const { return m_expiryHeap.size(); }
+
+	// Insert calls that added a new command, and those that extended an identical stored one instead.
+	[[nodiscard]] uint64_t GetInsertCount() const { return m_insertCount; }
+	[[nodiscard]] uint64_t GetDuplicateCount() const { return m_duplicateCount; }
+
+private:
+	struct Slot
+	{
+		Slot() { }
+
+		// Only holds a command while the slot is on the active list. DrawCommandPacket is trivially
+		// destructible, so slots are reused without running a destructor.
+		union
+		{
+			DrawCommandPacket cmd;
+		};
+
+		SlotIndex prev        = INVALID_SLOT;
+		SlotIndex next        = INVALID_SLOT; // Next newer command, or the next free slot
+		SlotIndex channelPrev = INVALID_SLOT;
+		SlotIndex channelNext = INVALID_SLOT;
+		uint32_t  generation  = 0; // Bumped whenever the slot is released, invalidating expiry entries
+		uint32_t  contentHash = 0;
+		uint8_t   channel     = 0;
+		bool      hashed      = false; // contentHash is valid and may be in m_contentIndex
+	};
+
+	// A command of the batch InsertBatch is adding.
+	struct PendingCommand
+	{
+		SlotIndex slot;        // The stored command it repeats, then the one holding it
+		uint32_t  contentHash;
+		bool      hashed;
+		bool      tracked;     // Needs an expiry entry once the batch is in
+	};
+
+	// An entry of the content index, empty while slot is INVALID_SLOT.
+	struct ContentEntry
+	{
+		uint32_t  hash = 0;
+		SlotIndex slot = INVALID_SLOT;
+	};
+
+	// Reference to a command from the expiry index, stale once the slot generation moved on.
+	struct ExpiryEntry
+	{
+		float     endTime;
+		SlotIndex slot;
+		uint32_t  generation;
+
+		// Orders the heap so the earliest end time is on top.
+		bool operator>(const ExpiryEntry &other) const { return endTime > other.endTime; }
+	};
+
+	SlotIndex AcquireSlot();
+	SlotIndex FindStored(uint32_t hash, uint8_t channel, const DrawCommandPacket &cmd) const;
+	void      PlaceCommand(SlotIndex slot, uint8_t channel, const DrawCommandPacket &cmd, bool hashed, uint32_t hash);
+
+	PendingCommand FindBatchDuplicate(uint8_t channel, const DrawCommandPacket &cmd);
+	void           ReserveSlots(size_t count);
+	void           AddBatchCommand(uint8_t channel, const DrawCommandPacket &cmd, PendingCommand &pending);
+	void           TrackBatchExpiry();
+
+	void      LinkNewest(SlotIndex slot);
+	void      Unlink(SlotIndex slot);
+	void      LinkChannel(SlotIndex slot, uint8_t channel);
+	void      UnlinkChannel(SlotIndex slot);
+	void      TrackExpiry(SlotIndex slot);
+	void      ExtendExpiry(SlotIndex slot, float endTime);
+	void      CompactExpiryHeap();
+
+	// The slot still holds the command the entry was made for.
+	bool IsLive(const ExpiryEntry &entry) const { return m_slots[entry.slot].generation == entry.generation; }
+	// ... and its end time was not extended since.
+	bool IsCurrent(const ExpiryEntry &entry) const { return IsLive(entry) && m_slots[entry.slot].cmd.drawEndTime == entry.endTime; }
+
+	bool HasSameContent(SlotIndex slot, uint8_t channel, const DrawCommandPacket &cmd) const;
+
+	SlotIndex FindContent(uint32_t hash) const;
+	void      SetContent(uint32_t hash, SlotIndex slot);
+	void      EraseContent(uint32_t hash, SlotIndex slot);
+
+	std::unique_ptr<Slot[]> m_slots;
+	size_t                  m_capacity = 0;
+	size_t                  m_size     = 0;
+	SlotIndex               m_oldest   = INVALID_SLOT;
+	SlotIndex               m_newest   = INVALID_SLOT;
+	SlotIndex               m_freeList = INVALID_SLOT;
+
+	std::array<SlotIndex, DRAW_CHANNEL_COUNT> m_channelHeads; // Most recently added command of each channel
+
+	std::vector<ExpiryEntry> m_expiryHeap; // Timed commands, min-heap on endTime
+	std::vector<ExpiryEntry> m_transient;  // One-frame commands, dropped on the next expiry pass
+
+	std::vector<PendingCommand> m_batchPending; // Scratch of InsertBatch, one per command of the batch
+
+	bool                            m_deduplicate;
+	std::unique_ptr<ContentEntry[]> m_contentIndex;    // Content hash of timed commands to their slot, linear probing
+	size_t                          m_contentMask = 0; // Entries in m_contentIndex minus one, a power of two minus one
+	uint64_t                        m_insertCount    = 0;
+	uint64_t                        m_duplicateCount = 0;
+};
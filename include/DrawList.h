@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "SharedDefs.h"
+#include "StringPool.h"
+
+struct PrimitiveHierarchy;
+
+// Where a primitive is in a DrawList: its type, and its position in the streams of that type.
+// For TEXT, the position is in worldTexts or screenTexts, whichever the command went to.
+struct PrimitiveRef
+{
+	DrawCommandType type;
+	uint32_t        index;
+};
+
+// The draw commands of one snapshot, grouped by type into parallel arrays.
+// Geometry is converted to raylib space up front, so each render pass walks only the streams
+// of the types it draws, linearly and without branching on the command type.
+struct DrawList
+{
+	struct Lines
+	{
+		std::vector<Vector3> points; // Start and end of each line
+		std::vector<Color>   colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	struct Triangles
+	{
+		std::vector<Vector3> points; // Three corners per triangle
+		std::vector<Color>   colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	struct Spheres
+	{
+		std::vector<Vector3> centers;
+		std::vector<float>   radii;
+		std::vector<Color>   colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	struct Circles
+	{
+		std::vector<Vector3> centers;
+		std::vector<float>   radii;
+		std::vector<Vector3> rotationAxes;
+		std::vector<float>   rotationAngles;
+		std::vector<Color>   colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	struct Boxes
+	{
+		std::vector<Vector3> mins;
+		std::vector<Vector3> maxs;
+		std::vector<Color>   colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	// Texts of either kind, referring to their string in the interned string pool.
+	template <typename TPosition>
+	struct Texts
+	{
+		std::vector<TPosition>            positions;
+		std::vector<StringPool::StringId> stringIds;
+		std::vector<Color>                colors;
+
+		[[nodiscard]] size_t GetCount() const { return colors.size(); }
+	};
+
+	Lines            lines;
+	Triangles        triangles;
+	Spheres          spheres;
+	Circles          circles;
+	Boxes            boxes;
+	Texts<Vector3>   worldTexts;  // Projected onto the screen every frame
+	Texts<Vector2>   screenTexts; // Already in screen coordinates
+
+	// The pool the text string ids refer to. Kept alive by the snapshot for as long as it is rendered.
+	std::shared_ptr<const StringPool> strings;
+
+	// Set by the publisher to a new value whenever the contents change,
+	// so the renderer can keep what it uploaded to the GPU for an unchanged list.
+	uint64_t version = 0;
+
+	// Bounding volume hierarchy over the primitives, for the lists that have one,
+	// so culling and picking do not have to test every primitive.
+	std::shared_ptr<const PrimitiveHierarchy> hierarchy;
+
+	// Set when the list was patched rather than rebuilt: it is the list of version patchedFrom with only the
+	// primitives in patched changed, so the renderer can upload just those over what it has of that version.
+	uint64_t                  patchedFrom = 0;
+	std::vector<PrimitiveRef> patched;
+
+	// Appends a command to the streams of its type. textId is the interned text of a TEXT command.
+	// Returns where the command went, or nullopt if it was dropped.
+	std::optional<PrimitiveRef> Add(const DrawCommandPacket &cmd, StringPool::StringId textId = StringPool::INVALID_ID);
+
+	// Overwrites the primitive Add put at primitive with the command, which must be of the same type
+	// (and for TEXT, of the same kind). The text of a TEXT primitive is kept.
+	void Set(const PrimitiveRef &primitive, const DrawCommandPacket &cmd);
+
+	// Number of primitives of the type, texts of both kinds for TEXT.
+	[[nodiscard]] size_t GetCount(DrawCommandType type) const;
+
+	[[nodiscard]] const char *GetText(const StringPool::StringId id) const { return strings->Get(id); }
+
+	// Empties every stream, keeping their storage for the next snapshot.
+	void Clear();
+};
+
+// What the render thread gets: the draw commands, plus the retained objects. The retained list is only
+// rebuilt when a retained object changes and is shared between snapshots otherwise.
+struct DrawSnapshot
+{
+	DrawList                        commands;
+	std::shared_ptr<const DrawList> retained;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DrawList.h"
+
+// Culled and visible primitive counts of the last Cull, indexed by DrawCommandType (TEXT is never culled).
+struct CullStats
+{
+	std::array<size_t, static_cast<size_t>(DrawCommandType::TEXT)> visible{};
+	std::array<size_t, static_cast<size_t>(DrawCommandType::TEXT)> culled{};
+};
+
+// Bounding spheres of the primitives of one type, as separate coordinate streams for SIMD tests.
+struct BoundingSpheres
+{
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radii;
+
+	[[nodiscard]] size_t GetCount() const { return radii.size(); }
+
+	void Add(const Vector3 &center, float radius);
+	void Clear();
+};
+
+// The six planes of the camera frustum, normals pointing inwards.
+struct Frustum
+{
+	std::array<Vector4, 6> planes; // x * nx + y * ny + z * nz + w >= 0 inside
+
+	// Appends the indices of the spheres that are at least partly inside.
+	void CullSpheres(const BoundingSpheres &spheres, std::vector<uint32_t> &visible) const;
+};
+
+// The lines, triangles, spheres, circles and boxes of one draw list inside the camera frustum,
+// as their positions in the streams of each type, in list order.
+struct Visibility
+{
+	std::array<std::vector<uint32_t>, static_cast<size_t>(DrawCommandType::TEXT)> indices;
+
+	// Changes whenever indices do, so the batchers know when to upload them again.
+	uint64_t version = 0;
+
+	[[nodiscard]] const std::vector<uint32_t> &Get(const DrawCommandType type) const { return indices[static_cast<size_t>(type)]; }
+};
+
+// Finds the lines, triangles, spheres, circles and boxes of draw lists that are inside the camera frustum.
+// The lists themselves are left alone: the batchers keep the geometry they uploaded for a list version
+// and only draw the visible part of it. Texts are left out, ScreenProjector culls them.
+// Bounds are computed once per list version. A list is only culled again when it or the camera changed,
+// and its visibility only gets a new version when the visible set is different.
+// Lists with a hierarchy are culled by querying it instead, which only visits the parts of it near the view.
+class FrustumCuller
+{
+public:
+	// Culls the lists against the frustum. The returned visibilities correspond to the given lists, in order,
+	// and stay valid until the next call.
+	std::span<const Visibility> Cull(std::span<const DrawList *const> lists, const Frustum &frustum);
+
+	[[nodiscard]] const CullStats &GetStats() const { return m_stats; }
+
+private:
+	using TypeBounds  = std::array<BoundingSpheres, static_cast<size_t>(DrawCommandType::TEXT)>;
+	using TypeIndices = std::array<std::vector<uint32_t>, static_cast<size_t>(DrawCommandType::TEXT)>;
+
+	// The cull state of the list at one position.
+	struct Entry
+	{
+		uint64_t   sourceVersion = UINT64_MAX; // Version of the list the bounds were computed for
+		TypeBounds bounds;
+		Frustum    frustum{};       // Frustum the visibility was computed for
+		bool       culled = false;  // visibility holds the result for sourceVersion and frustum
+		CullStats  stats;
+	};
+
+	static void ComputeBounds(const DrawList &list, TypeBounds &bounds);
+	void        CullEntry(Entry &entry, Visibility &visibility, const DrawList &list, const Frustum &frustum);
+	void        QueryHierarchy(const PrimitiveHierarchy &hierarchy, const Frustum &frustum);
+
+	std::vector<Entry>      m_entries;
+	std::vector<Visibility> m_visibilities;   // Per entry, kept apart so Cull can hand them out as a span
+	TypeIndices             m_visibleIndices; // Scratch for one list
+	std::vector<uint32_t>   m_visibleLeaves;  // Scratch for QueryHierarchy
+	CullStats               m_stats;
+	uint64_t                m_nextVersion = 1;
+};
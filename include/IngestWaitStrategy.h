@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "config.h"
+#include "SharedDefs.h"
+#include "SharedMemoryTransport.h"
+
+// Log2-bucketed histogram of durations, from <1us up to >=2^20us (~1s).
+class LatencyHistogram
+{
+public:
+	void Record(std::chrono::nanoseconds duration);
+	void Print(std::ostream &out, const char *name) const;
+
+	[[nodiscard]] uint64_t GetCount() const { return m_count; }
+
+private:
+	static constexpr size_t BUCKET_COUNT = 22;
+
+	std::array<uint64_t, BUCKET_COUNT> m_buckets = {};
+	uint64_t                           m_count   = 0;
+};
+
+// Decides how the ingest thread waits for new data: busy-poll head for a short spin budget,
+// then yield, then block on the transport. The server only signals while we are blocked,
+// so polling ticks cost it no syscall. In adaptive mode it also learns the interval between
+// ticks and blocks through the quiet part of it, so it only spins when the next tick is due.
+class IngestWaitStrategy
+{
+public:
+	explicit IngestWaitStrategy(Config::IngestWaitMode mode = Config::INGEST_WAIT_MODE);
+
+	// Waits until the server's head moves away from tail, or the block phase times out.
+	// Returns true if there is data to drain.
+	bool Wait(SharedMemoryTransport &transport, SharedMemoryLayout &layout, size_t tail);
+
+	// Resets the shared wake state so the server signals whoever connects next.
+	void OnStop(SharedMemoryLayout &layout);
+
+	// Prints how long the thread waited before finding data, per phase that found it.
+	void PrintStats(std::ostream &out) const;
+
+	// Signals the server sent so far, counted from the signal word it bumps for each of them.
+	[[nodiscard]] uint64_t GetSignalsSent() const { return m_signalsSent.load(std::memory_order_relaxed); }
+	// Waits that found data while polling, so the server saw POLLING and did not signal for it.
+	[[nodiscard]] uint64_t GetSignalsElided() const { return m_signalsElided.load(std::memory_order_relaxed); }
+
+private:
+	enum class Phase : std::uint8_t
+	{
+		SLEEP, // Adaptive block ahead of the expected tick
+		SPIN,
+		YIELD,
+		BLOCK,
+		COUNT
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	static bool Block(SharedMemoryTransport &transport, SharedMemoryLayout &layout, size_t tail, uint32_t timeoutMs);
+
+	bool OnData(Phase phase, Clock::time_point waitStart);
+	void CountSignals(SharedMemoryLayout &layout);
+
+	Config::IngestWaitMode m_mode;
+
+	Clock::time_point        m_lastDataTime;
+	std::chrono::nanoseconds m_tickInterval = std::chrono::nanoseconds::zero(); // Smoothed interval between wakes with data
+
+	std::array<LatencyHistogram, static_cast<size_t>(Phase::COUNT)> m_wakeHistograms;
+
+	// Only written by the waiting thread, read from any
+	std::atomic<uint64_t> m_signalsSent   = 0;
+	std::atomic<uint64_t> m_signalsElided = 0;
+	uint32_t              m_lastSignal    = 0;     // Signal word as of the last CountSignals
+	bool                  m_signalCounted = false; // m_lastSignal was read from the current connection
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DrawList.h"
+#include "FrustumCuller.h"
+#include "Raylib/raymath.h"
+
+// Draws the spheres, circles and boxes of any number of draw lists as instances of unit wire meshes,
+// one instanced call per shape. The meshes are built once; each instance only carries a transform and a color.
+// Like LineBatcher, the instances live in persistent GPU buffers, list after list, and Update only
+// re-uploads the lists whose version changed, plus the ones behind them if that moved their offset.
+// Of a list patched from the uploaded version, only the patched instances are uploaded.
+// The shader reads the instances from texture buffers over those, through a per instance index, so culling
+// only has to upload the indices of the visible instances and leaves the transforms and colors alone.
+// Needs the GL context, so create it after the window and destroy it before closing it.
+class InstanceBatcher
+{
+public:
+	InstanceBatcher();
+	~InstanceBatcher();
+
+	InstanceBatcher(const InstanceBatcher &other)                = delete;
+	InstanceBatcher(InstanceBatcher &&other) noexcept            = delete;
+	InstanceBatcher &operator=(const InstanceBatcher &other)     = delete;
+	InstanceBatcher &operator=(InstanceBatcher &&other) noexcept = delete;
+
+	// Makes the GPU buffers hold the instances of the given lists, in order. With visibility, which must correspond
+	// to the lists, only their visible instances are drawn; the indices are rebuilt when a visibility version changes.
+	void Update(std::span<const DrawList *const> lists, std::span<const Visibility> visibility = {});
+
+	// Draws the instances of the last Update with the current rlgl matrices. Call between BeginMode3D and EndMode3D.
+	void Draw() const;
+
+	[[nodiscard]] bool IsValid() const;
+
+private:
+	enum ShapeType : uint8_t
+	{
+		SPHERE,
+		CIRCLE,
+		BOX,
+		SHAPE_COUNT,
+	};
+
+	// Where a list was uploaded to, to tell whether it has to be uploaded again.
+	struct UploadedList
+	{
+		uint64_t version       = UINT64_MAX;
+		size_t   firstInstance = 0;
+		size_t   instanceCount = 0;
+	};
+
+	// The visibility the index buffer of a shape was built from, per list.
+	struct IndexedList
+	{
+		uint64_t version       = UINT64_MAX;
+		size_t   firstInstance = 0;
+	};
+
+	// A unit wire mesh and the instances drawn of it.
+	struct Shape
+	{
+		unsigned int vertexArray      = 0;
+		unsigned int meshBuffer       = 0;
+		unsigned int transformBuffer  = 0; // float16 per instance, column-major
+		unsigned int colorBuffer      = 0; // Color per instance
+		unsigned int transformTexture = 0; // Texture buffers the shader reads the two above through
+		unsigned int colorTexture     = 0;
+		unsigned int indexBuffer      = 0; // Instance to draw, per drawn instance
+		int          vertexCount      = 0; // Line vertices in meshBuffer
+		size_t       capacity         = 0; // Instances the buffers can hold
+		size_t       indexCapacity    = 0; // Indices indexBuffer can hold
+		size_t       instanceCount    = 0; // Instances uploaded
+		size_t       drawCount        = 0; // Indices in indexBuffer
+		bool         culled           = false; // indexBuffer holds the visible instances, not all of them
+
+		std::vector<UploadedList> uploaded;
+		std::vector<IndexedList>  indexed;
+	};
+
+	using DrawArraysInstanced = void (WINAPI *)(unsigned int mode, int first, int count, int instanceCount);
+	using TexBuffer           = void (WINAPI *)(unsigned int target, unsigned int internalFormat, unsigned int buffer);
+
+	bool LoadShape(Shape &shape, const std::vector<Vector3> &lineVertices);
+	void Reserve(Shape &shape, size_t instanceCount);
+	void ReserveIndices(Shape &shape, size_t indexCount);
+	void UpdateShape(ShapeType type, std::span<const DrawList *const> lists);
+	void UploadInstances(ShapeType type, const DrawList &list, size_t first, size_t count, size_t firstInstance);
+	void UpdateIndices(ShapeType type, std::span<const Visibility> visibility);
+
+	static size_t GetInstanceCount(ShapeType type, const DrawList &list);
+	static void   AddTransforms(ShapeType type, const DrawList &list, size_t first, size_t count, std::vector<float16> &transforms);
+	static const std::vector<Color> &GetColors(ShapeType type, const DrawList &list);
+	static DrawCommandType           GetCommandType(ShapeType type);
+
+	unsigned int                   m_shader              = 0;
+	int                            m_mvpLocation         = -1;
+	int                            m_transformsLocation  = -1;
+	int                            m_colorsLocation      = -1;
+	DrawArraysInstanced            m_drawArraysInstanced = nullptr; // glDrawArraysInstanced, which rlgl only calls for triangles
+	TexBuffer                      m_texBuffer           = nullptr; // glTexBuffer, which rlgl does not use at all
+	std::array<Shape, SHAPE_COUNT> m_shapes;
+	std::vector<float16>           m_transforms; // Per instance transforms of the list being uploaded
+	std::vector<float>             m_indices;    // Instances to draw of the shape being indexed
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DrawList.h"
+#include "FrustumCuller.h"
+
+// Draws the lines of any number of draw lists with a single GL_LINES call.
+// The vertices live in persistent GPU buffers, laid out list after list. Update only re-uploads
+// the lists whose version changed, plus the ones behind them if that moved their offset.
+// Of a list patched from the uploaded version, only the patched lines are uploaded.
+// Culling does not touch the vertices: the visible lines are drawn through an index buffer over them.
+// Needs the GL context, so create it after the window and destroy it before closing it.
+class LineBatcher
+{
+public:
+	LineBatcher();
+	~LineBatcher();
+
+	LineBatcher(const LineBatcher &other)                = delete;
+	LineBatcher(LineBatcher &&other) noexcept            = delete;
+	LineBatcher &operator=(const LineBatcher &other)     = delete;
+	LineBatcher &operator=(LineBatcher &&other) noexcept = delete;
+
+	// Makes the GPU buffers hold the lines of the given lists, in order. With visibility, which must correspond
+	// to the lists, only their visible lines are drawn; the index buffer is rebuilt when a visibility version changes.
+	void Update(std::span<const DrawList *const> lists, std::span<const Visibility> visibility = {});
+
+	// Draws the lines of the last Update with the current rlgl matrices. Call between BeginMode3D and EndMode3D.
+	void Draw() const;
+
+	[[nodiscard]] bool IsValid() const { return m_shader != 0 && m_vertexArray != 0; }
+
+private:
+	// Where a list was uploaded to, to tell whether it has to be uploaded again.
+	struct UploadedList
+	{
+		uint64_t version     = UINT64_MAX;
+		size_t   firstVertex = 0;
+		size_t   vertexCount = 0;
+	};
+
+	// The visibility the index buffer was built from, per list.
+	struct IndexedList
+	{
+		uint64_t version     = UINT64_MAX;
+		size_t   firstVertex = 0;
+	};
+
+	void Reserve(size_t vertexCount);
+	void UploadLines(const DrawList::Lines &lines, size_t first, size_t count, size_t firstVertex);
+	void ReserveIndices(size_t indexCount);
+	void UpdateIndices(std::span<const Visibility> visibility);
+
+	unsigned int m_shader         = 0;
+	int          m_mvpLocation    = -1;
+	unsigned int m_vertexArray    = 0;
+	unsigned int m_positionBuffer = 0;
+	unsigned int m_colorBuffer    = 0;
+	size_t       m_capacity       = 0; // Vertices the buffers can hold
+	size_t       m_vertexCount    = 0; // Vertices to draw
+	unsigned int m_indexBuffer    = 0;
+	size_t       m_indexCapacity  = 0;
+	size_t       m_indexCount     = 0;
+	bool         m_drawIndexed    = false; // Draw m_indexCount indices instead of all m_vertexCount vertices
+
+	std::vector<UploadedList> m_uploaded;
+	std::vector<IndexedList>  m_indexedLists;
+	std::vector<Color>        m_colors;  // Per vertex colors of the list being uploaded
+	std::vector<uint32_t>     m_indices; // Visible vertices of all lists, while building the index buffer
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "BoundingVolumeHierarchy.h"
+#include "SharedDefs.h"
+#include "StringPool.h"
+
+// Retained objects by their server chosen id. Objects are kept densely packed for iteration,
+// with a hash index from id to position. Destroying swaps the last object into the hole.
+// Every object but a TEXT one also has a leaf in a bounding volume hierarchy, whose payload is its position.
+class RetainedObjectStore
+{
+public:
+	struct Object
+	{
+		uint64_t             id;
+		uint8_t              channel;
+		DrawCommandPacket    cmd;    // The geometry as created, drawEndTime is ignored
+		Vector               offset; // Translation applied on top of cmd
+		StringPool::StringId textId; // Interned text of a TEXT object
+		int32_t              leaf;   // Its leaf in the hierarchy, NULL_NODE for a TEXT object
+
+		// The command to draw, with the offset applied.
+		[[nodiscard]] DrawCommandPacket GetTransformed() const;
+
+		// Bounds of the transformed command in raylib space. Meaningless for a TEXT object.
+		[[nodiscard]] BoundingBox GetBounds() const;
+	};
+
+	explicit RetainedObjectStore(size_t capacity);
+
+	// Creates an object, or replaces the one with the same id. Returns nullptr if the store is full.
+	Object *Create(uint64_t id, uint8_t channel, const DrawCommandPacket &cmd);
+
+	// Returns the object with the given id, or nullptr if there is none.
+	Object *Find(uint64_t id);
+
+	// Moves an object, refitting its leaf in the hierarchy.
+	void SetOffset(Object &object, const Vector &offset);
+
+	// Returns false if there is no object with the given id.
+	bool Destroy(uint64_t id);
+
+	// Destroys every object in the channel. Returns the number destroyed.
+	size_t DestroyChannel(uint8_t channel);
+
+	void Clear();
+
+	[[nodiscard]] std::vector<Object>       &GetObjects() { return m_objects; }
+	[[nodiscard]] const std::vector<Object> &GetObjects() const { return m_objects; }
+
+	[[nodiscard]] const BoundingVolumeHierarchy &GetHierarchy() const { return m_hierarchy; }
+
+	[[nodiscard]] size_t GetSize() const { return m_objects.size(); }
+	[[nodiscard]] size_t GetChannelCount(const uint8_t channel) const { return m_channelCounts[channel]; }
+	[[nodiscard]] size_t GetCapacity() const { return m_capacity; }
+
+private:
+	void RemoveAt(size_t index);
+	void UpdateLeaf(size_t index);
+
+	std::vector<Object>                    m_objects;
+	std::unordered_map<uint64_t, uint32_t> m_indices; // Object id to its position in m_objects
+	size_t                                 m_capacity;
+	BoundingVolumeHierarchy                m_hierarchy;
+
+	std::array<uint32_t, DRAW_CHANNEL_COUNT> m_channelCounts = {}; // Lets clearing an empty channel skip the scan
+};
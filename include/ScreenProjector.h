@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Raylib/raylib.h"
+
+// The points of a batch that landed on the screen, in input order.
+struct ProjectedPoints
+{
+	std::vector<uint32_t> indices;   // Index of each visible point in the projected span
+	std::vector<Vector2>  positions; // Its screen position, as GetWorldToScreen would return it
+
+	[[nodiscard]] size_t GetCount() const { return indices.size(); }
+
+	void Clear()
+	{
+		indices.clear();
+		positions.clear();
+	}
+};
+
+// Projects world points onto the screen like GetWorldToScreen, but builds the view-projection matrix
+// once rather than per point, and handles four points per step with SSE.
+// A point is visible when it is in front of the camera and inside the screen.
+class ScreenProjector
+{
+public:
+	ScreenProjector(const Camera3D &camera, int screenWidth, int screenHeight);
+
+	// Replaces the contents of out with the visible points.
+	void Project(std::span<const Vector3> points, ProjectedPoints &out) const;
+
+	// Same as Project, one point at a time. The reference the SIMD path has to match.
+	void ProjectScalar(std::span<const Vector3> points, ProjectedPoints &out) const;
+
+private:
+	void ProjectScalar(std::span<const Vector3> points, size_t first, ProjectedPoints &out) const;
+
+	Matrix m_viewProjection;
+	float  m_width;
+	float  m_height;
+};
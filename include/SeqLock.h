@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single writer, many readers sequence lock for small trivially copyable values.
+// The writer never waits. Readers retry until they copied a value no write overlapped with,
+// so they always get a consistent one, never a mix of two writes.
+// The value is stored as relaxed atomic words, so the copies racing a write are still well defined.
+template <typename T>
+class SeqLock
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	// Writer side: replaces the value.
+	void Store(const T &value)
+	{
+		std::array<uint32_t, WORD_COUNT> words{};
+		memcpy(words.data(), &value, sizeof(T));
+
+		// An odd sequence marks a write in progress. The fence keeps the word stores below the increment.
+		const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+		m_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < WORD_COUNT; i++)
+		{
+			m_words[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		m_sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// Reader side: returns the latest value.
+	T Load() const
+	{
+		std::array<uint32_t, WORD_COUNT> words;
+		uint32_t                         before, after;
+		do
+		{
+			before = m_sequence.load(std::memory_order_acquire);
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				words[i] = m_words[i].load(std::memory_order_relaxed);
+			}
+			// Keeps the word loads above the second sequence load.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = m_sequence.load(std::memory_order_relaxed);
+		}
+		while (before != after || (before & 1) != 0);
+
+		// T may have default member initializers, which make it non-trivial but not any less trivially copyable.
+		T value;
+		memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+		return value;
+	}
+
+private:
+	static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+	std::atomic<uint32_t>                         m_sequence = 0;
+	std::array<std::atomic<uint32_t>, WORD_COUNT> m_words{};
+};
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <win32_minimal.h>
 
+#include "Crc32c.h"
 #include "Raylib/raylib.h"
 
 // Not packed.
@@ -26,10 +30,50 @@ struct QAngle
 constexpr auto SHARED_MEM_NAME = L"CS2DebugOverlay_SharedMem";
 constexpr auto EVENT_NAME      = L"CS2DebugOverlay_NewDataEvent";
 
-// The size of the circular buffer in shared memory.
+// Name of the POSIX shared memory object used on Linux.
+// There is no named event there, the server signals through SharedMemoryLayout::signal instead.
+constexpr auto SHARED_MEM_POSIX_NAME = "/CS2DebugOverlay_SharedMem";
+
+// The default size of the circular buffer in shared memory.
+// The actual size is chosen by the server at runtime and published in SharedMemoryLayout::capacity.
 // Must be a power of 2 for efficient bitwise arithmetic on head/tail indices.
 constexpr size_t SHARED_MEM_BUFFER_SIZE = static_cast<size_t>(2048) * static_cast<size_t>(2048); // 4MB
 
+// Bounds the client accepts for SharedMemoryLayout::capacity.
+// The lower bound keeps the buffer a multiple of the allocation granularity, which mirroring requires.
+constexpr size_t SHARED_MEM_MIN_BUFFER_SIZE = static_cast<size_t>(64) * 1024;          // 64KB
+constexpr size_t SHARED_MEM_MAX_BUFFER_SIZE = static_cast<size_t>(1024) * 1024 * 1024; // 1GB
+
+// The size of the control block in front of the circular buffer.
+// Matches the allocation granularity so the buffer can be mapped a second time directly behind itself.
+constexpr size_t SHARED_MEM_HEADER_SIZE = static_cast<size_t>(64) * 1024; // 64KB
+
+// Identifies the control block and the protocol spoken over the buffer.
+// The version changes whenever the layout or an existing packet changes in an incompatible way.
+constexpr uint32_t SHARED_MEM_MAGIC            = 0x4F524541; // "AERO"
+constexpr uint32_t SHARED_MEM_PROTOCOL_VERSION = 2;
+
+// Optional protocol features, announced by the server in SharedMemoryLayout::features.
+// The client refuses to connect if the server uses a feature it does not know.
+namespace SharedMemFeature
+{
+	constexpr uint64_t CLIENT_WAKE_STATE     = 1ull << 0; // The server honors clientState and may skip signals (see ShouldSignalClient)
+	constexpr uint64_t COMPACT_DRAW_COMMANDS = 1ull << 1; // The server may send DRAW_COMMAND_COMPACT packets
+	constexpr uint64_t DRAW_BATCHES          = 1ull << 2; // The server may send DRAW_BATCH packets
+	constexpr uint64_t CHECKED_FRAMING       = 1ull << 3; // Every packet starts with a FramedPacketHeader instead of a PacketHeader
+	constexpr uint64_t RETAINED_OBJECTS      = 1ull << 4; // The server may send RETAINED_CREATE/UPDATE/DESTROY packets
+	constexpr uint64_t DRAW_CHANNELS         = 1ull << 5; // The server may send SET_CHANNEL, CLEAR_CHANNEL and SET_CHANNEL_VISIBLE packets
+	constexpr uint64_t CAMERA_REGISTER       = 1ull << 6; // The server keeps SharedMemoryLayout::camera up to date (see WriteCameraRegister)
+}
+
+constexpr uint64_t SHARED_MEM_SUPPORTED_FEATURES = SharedMemFeature::CLIENT_WAKE_STATE |
+                                                   SharedMemFeature::COMPACT_DRAW_COMMANDS |
+                                                   SharedMemFeature::DRAW_BATCHES |
+                                                   SharedMemFeature::CHECKED_FRAMING |
+                                                   SharedMemFeature::RETAINED_OBJECTS |
+                                                   SharedMemFeature::DRAW_CHANNELS |
+                                                   SharedMemFeature::CAMERA_REGISTER;
+
 // --- Packet Definitions ---
 #pragma pack(push, 1)
 
@@ -90,8 +134,9 @@ struct TextCommandData
 {
 	explicit TextCommandData(const Vector &position, const char *msg) : position(position), onscreen(false)
 	{
-		strncpy_s(text, msg, sizeof(text) - 1);
-		text[sizeof(text) - 1] = '\0'; // Ensure null-termination
+		const size_t length = strnlen(msg, sizeof(text) - 1);
+		memcpy(text, msg, length);
+		text[length] = '\0'; // Ensure null-termination
 	}
 
 	Vector position;
@@ -123,6 +168,163 @@ struct DrawCommandPacket
 	};
 };
 
+// --- Compact Draw Commands ---
+// A DRAW_COMMAND_COMPACT packet carries a CompactDrawHeader followed by only the payload of its type:
+// the matching *CommandData struct, or for TEXT a CompactTextData followed by `length` characters
+// (not null-terminated). This avoids shipping every command padded to the size of TextCommandData.
+
+struct CompactDrawHeader
+{
+	DrawCommandType type;
+	Color           color;
+	float           drawEndTime;
+};
+
+struct CompactTextData
+{
+	Vector       position;
+	bool         onscreen;
+	std::uint8_t length; // Number of characters that follow
+};
+
+constexpr size_t MAX_COMPACT_TEXT_LENGTH       = sizeof(TextCommandData::text) - 1;
+constexpr size_t MAX_COMPACT_DRAW_COMMAND_SIZE = sizeof(CompactDrawHeader) + sizeof(CompactTextData) + MAX_COMPACT_TEXT_LENGTH;
+
+// Server side: encodes a draw command as the payload of a DRAW_COMMAND_COMPACT packet.
+// `out` must hold at least MAX_COMPACT_DRAW_COMMAND_SIZE bytes. Returns the number of bytes written.
+inline size_t EncodeCompactDrawCommand(const DrawCommandPacket &cmd, std::byte *out)
+{
+	const CompactDrawHeader header = {cmd.type, cmd.color, cmd.drawEndTime};
+	memcpy(out, &header, sizeof(header));
+
+	std::byte *payload = out + sizeof(header);
+	switch (cmd.type)
+	{
+		case DrawCommandType::LINE:
+			memcpy(payload, &cmd.line, sizeof(cmd.line));
+			return sizeof(header) + sizeof(cmd.line);
+		case DrawCommandType::TRIANGLE:
+			memcpy(payload, &cmd.triangle, sizeof(cmd.triangle));
+			return sizeof(header) + sizeof(cmd.triangle);
+		case DrawCommandType::SPHERE:
+			memcpy(payload, &cmd.sphere, sizeof(cmd.sphere));
+			return sizeof(header) + sizeof(cmd.sphere);
+		case DrawCommandType::CIRCLE:
+			memcpy(payload, &cmd.circle, sizeof(cmd.circle));
+			return sizeof(header) + sizeof(cmd.circle);
+		case DrawCommandType::BBOX:
+			memcpy(payload, &cmd.box, sizeof(cmd.box));
+			return sizeof(header) + sizeof(cmd.box);
+		case DrawCommandType::TEXT:
+		{
+			const CompactTextData text = {cmd.text.position, cmd.text.onscreen, static_cast<std::uint8_t>(strnlen(cmd.text.text, MAX_COMPACT_TEXT_LENGTH))};
+			memcpy(payload, &text, sizeof(text));
+			memcpy(payload + sizeof(text), cmd.text.text, text.length);
+			return sizeof(header) + sizeof(text) + text.length;
+		}
+	}
+
+	return 0;
+}
+
+// --- Draw Batches ---
+// A DRAW_BATCH packet carries a DrawBatchHeader followed by `count` items that all share its type,
+// color and end time. For LIST batches an item is the *CommandData struct of the type (TEXT is not
+// supported), for POLYLINE batches (LINE only) an item is a Vector and consecutive points are connected.
+
+enum class DrawBatchLayout : std::uint8_t
+{
+	LIST,
+	POLYLINE,
+};
+
+struct DrawBatchHeader
+{
+	DrawCommandType type;
+	Color           color;
+	float           drawEndTime;
+	DrawBatchLayout layout;
+	std::uint32_t   count;
+};
+
+// Size of one item in a DRAW_BATCH of the given type and layout, or 0 if the combination is not supported.
+constexpr size_t GetDrawBatchItemSize(const DrawCommandType type, const DrawBatchLayout layout)
+{
+	if (layout == DrawBatchLayout::POLYLINE)
+		return type == DrawCommandType::LINE ? sizeof(Vector) : 0;
+
+	switch (type)
+	{
+		case DrawCommandType::LINE:
+			return sizeof(LineCommandData);
+		case DrawCommandType::TRIANGLE:
+			return sizeof(TriangleCommandData);
+		case DrawCommandType::SPHERE:
+			return sizeof(SphereCommandData);
+		case DrawCommandType::CIRCLE:
+			return sizeof(CircleCommandData);
+		case DrawCommandType::BBOX:
+			return sizeof(BBoxCommandData);
+		case DrawCommandType::TEXT:
+			return 0;
+	}
+
+	return 0;
+}
+
+// --- Retained Objects ---
+// Retained objects are created once and kept by the client until they are destroyed or all drawings
+// are cleared, instead of expiring like draw commands. The server chooses their 64-bit ids.
+// A RETAINED_CREATE packet carries a RetainedCreateHeader followed by the object as a DRAW_COMMAND_COMPACT
+// payload, whose drawEndTime is ignored. Creating an id that already exists replaces that object.
+
+struct RetainedCreateHeader
+{
+	std::uint64_t id;
+};
+
+// Which fields of a RetainedUpdateData to apply.
+namespace RetainedUpdateField
+{
+	constexpr std::uint8_t COLOR  = 1 << 0;
+	constexpr std::uint8_t OFFSET = 1 << 1;
+}
+
+struct RetainedUpdateData
+{
+	std::uint64_t id;
+	std::uint8_t  fields; // RetainedUpdateField bits
+	Color         color;
+	Vector        offset; // Translation of the object relative to the geometry it was created with
+};
+
+struct RetainedDestroyData
+{
+	std::uint64_t id;
+};
+
+// --- Channels ---
+// Draw commands and retained objects are filed under the channel selected by the last SET_CHANNEL packet
+// (channel 0 until then), so the drawings of one subsystem can be cleared or hidden without touching the others.
+
+constexpr size_t DRAW_CHANNEL_COUNT = 256;
+
+struct SetChannelData
+{
+	std::uint8_t channel;
+};
+
+struct ClearChannelData
+{
+	std::uint8_t channel;
+};
+
+struct SetChannelVisibleData
+{
+	std::uint8_t channel;
+	bool         visible; // Hidden channels drop new draw commands and are not rendered
+};
+
 struct WorldUpdatePacket
 {
 	WorldUpdatePacket(const QAngle &view_angles, const Vector &origin, float curtime) : viewAngles(view_angles), origin(origin), curtime(curtime) { }
@@ -136,7 +338,15 @@ enum class PacketType : std::uint8_t
 {
 	WORLD_UPDATE,
 	DRAW_COMMAND,
-	CLEAR_ALL_DRAWINGS
+	CLEAR_ALL_DRAWINGS,
+	DRAW_COMMAND_COMPACT, // CompactDrawHeader + type specific payload, see EncodeCompactDrawCommand
+	DRAW_BATCH,           // DrawBatchHeader + count items sharing its type, color and end time
+	RETAINED_CREATE,      // RetainedCreateHeader + compact draw command, see Retained Objects
+	RETAINED_UPDATE,      // RetainedUpdateData
+	RETAINED_DESTROY,     // RetainedDestroyData
+	SET_CHANNEL,          // SetChannelData, see Channels
+	CLEAR_CHANNEL,        // ClearChannelData
+	SET_CHANNEL_VISIBLE,  // SetChannelVisibleData
 };
 
 // A header that precedes every packet in the buffer.
@@ -146,23 +356,180 @@ struct PacketHeader
 	uint32_t   size; // The size of the data that follows this header
 };
 
+// Marks the start of a FramedPacketHeader, so the client can find the next packet after a corrupted one.
+constexpr uint32_t SHARED_MEM_SYNC_WORD = 0x5CA1AB1E;
+
+// The header that precedes every packet instead of PacketHeader when SharedMemFeature::CHECKED_FRAMING is set.
+// The checksum covers the type, the size and the data, see ComputePacketChecksum.
+struct FramedPacketHeader
+{
+	uint32_t   sync; // SHARED_MEM_SYNC_WORD
+	PacketType type;
+	uint32_t   size;     // The size of the data that follows this header
+	uint32_t   checksum; // CRC32C of the equivalent PacketHeader followed by the data
+};
+
+// Checksum stored in FramedPacketHeader::checksum for a packet of the given type and data.
+inline uint32_t ComputePacketChecksum(const PacketType type, const uint32_t size, const std::byte *data)
+{
+	const PacketHeader header = {type, size};
+	return ComputeCrc32c(data, size, ComputeCrc32c(&header, sizeof(header)));
+}
+
+#pragma pack(pop)
+
 // --- Shared Memory Layout ---
+// Not packed: the fields written by different sides each get a cache line of their own, which packing would undo.
+
+// Whether the client needs to be signaled about new data, see SharedMemoryLayout::clientState.
+enum class ClientWakeState : std::uint32_t
+{
+	NEEDS_SIGNAL = 0, // The client is blocked (or about to block) on the event/futex. Zero so a fresh mapping is conservative.
+	POLLING      = 1, // The client is awake and will see a new head without being signaled.
+};
+
+// The latest camera, written in place by the server so it never waits behind queued draw commands.
+// A sequence lock: the server makes sequence odd, writes the fields and makes it even again.
+// A reader retries while it is odd or changed during its read, and can tell a new value by a new sequence.
+// Every field is accessed through std::atomic_ref, see WriteCameraRegister and ReadCameraRegister.
+struct CameraRegister
+{
+	uint32_t sequence; // Even when the fields are consistent, 0 before the first write
+	QAngle   viewAngles;
+	Vector   origin;
+	float    curtime;
+};
 
 // This is the structure that will be mapped into both processes.
-// It contains the head/tail for the circular buffer and the buffer itself.
+// It is the control block holding the protocol header and the head/tail for the circular buffer,
+// which directly follows it (see GetBuffer).
 struct SharedMemoryLayout
 {
-	// The head is the index where the server will write the next packet.
-	// It is only ever written to by the server.
-	alignas(64) volatile size_t head;
-
-	// The tail is the index where the client will read the next packet.
-	// It is only ever written to by the client.
-	alignas(64) volatile size_t tail;
+	union
+	{
+		struct
+		{
+			// Protocol header, filled in by the server before it creates the signal object.
+			// magic is written last (with release), so a client seeing it can trust the rest.
+			alignas(64) uint32_t magic;
+			uint32_t             version;
+			uint64_t             capacity; // Size of the buffer in bytes, a power of 2
+			uint64_t             features; // SharedMemFeature bits used by the server
+
+			// The head is the index where the server will write the next packet.
+			// It is only ever written to by the server, with a release store through std::atomic_ref
+			// once the packet data is in place. The client loads it with acquire.
+			alignas(64) size_t head;
+
+			// The tail is the index where the client will read the next packet.
+			// It is only ever written to by the client, with a release store through std::atomic_ref
+			// once it is done with the data before it. The server loads it with acquire.
+			// The client may publish it once per batch of packets rather than after every packet.
+			alignas(64) size_t tail;
+
+			// Futex word used instead of the named event on Linux.
+			// The server increments it after publishing a new head and wakes any waiters.
+			alignas(64) uint32_t signal;
+
+			// Written by the client, read by the server to decide whether a signal is needed.
+			// The client stores NEEDS_SIGNAL, issues a seq_cst fence and re-checks head before it blocks.
+			// The server publishes head, issues a seq_cst fence and only signals if it reads NEEDS_SIGNAL
+			// (see ShouldSignalClient). One of the two always sees the other's store, so no wakeup is lost.
+			alignas(64) ClientWakeState clientState;
+
+			// Only written when SharedMemFeature::CAMERA_REGISTER is set.
+			// WORLD_UPDATE packets are still sent, the client keeps taking curtime for expiry from them.
+			alignas(64) CameraRegister camera;
+		};
+
+		// Pads the control block so the buffer starts on an allocation granularity boundary.
+		std::byte header[SHARED_MEM_HEADER_SIZE];
+	};
 
-	// The data buffer.
+	// The data buffer of `capacity` bytes, directly behind the control block.
 	// Uses std::byte for type-safety when dealing with raw memory.
-	std::byte buffer[SHARED_MEM_BUFFER_SIZE];
+	// The client may map it a second time directly behind itself, so reads starting
+	// anywhere in the buffer can run past its end and still see the wrapped data.
+	[[nodiscard]] std::byte *GetBuffer() { return reinterpret_cast<std::byte*>(this) + SHARED_MEM_HEADER_SIZE; }
 };
 
-#pragma pack(pop)
+// Total size of the shared memory for a buffer of the given capacity.
+constexpr size_t GetSharedMemorySize(const size_t capacity)
+{
+	return SHARED_MEM_HEADER_SIZE + capacity;
+}
+
+static_assert(sizeof(SharedMemoryLayout) == SHARED_MEM_HEADER_SIZE, "The buffer must start right after the control block");
+static_assert(offsetof(SharedMemoryLayout, head) % 64 == 0 && offsetof(SharedMemoryLayout, tail) % 64 == 0 &&
+              offsetof(SharedMemoryLayout, signal) % 64 == 0 && offsetof(SharedMemoryLayout, clientState) % 64 == 0 &&
+              offsetof(SharedMemoryLayout, camera) % 64 == 0,
+              "Fields written by the server and by the client must not share a cache line");
+static_assert(offsetof(SharedMemoryLayout, head) == 64 && offsetof(SharedMemoryLayout, tail) == 128 && offsetof(SharedMemoryLayout, camera) == 320,
+              "The layout is shared with the server, a change needs a new SHARED_MEM_PROTOCOL_VERSION");
+static_assert(std::atomic_ref<size_t>::is_always_lock_free, "head/tail must be lock-free to be shared between processes");
+static_assert(std::atomic_ref<ClientWakeState>::is_always_lock_free, "clientState must be lock-free to be shared between processes");
+static_assert(std::atomic_ref<float>::is_always_lock_free && std::atomic_ref<uint32_t>::is_always_lock_free,
+              "camera must be lock-free to be shared between processes");
+
+// Server side: call after publishing a new head.
+// Returns true if the client is about to block and must be signaled, false if it is still polling head.
+inline bool ShouldSignalClient(SharedMemoryLayout &layout)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return std::atomic_ref(layout.clientState).load(std::memory_order_relaxed) == ClientWakeState::NEEDS_SIGNAL;
+}
+
+// Server side: publishes the latest camera to SharedMemoryLayout::camera.
+inline void WriteCameraRegister(SharedMemoryLayout &layout, const WorldUpdatePacket &update)
+{
+	CameraRegister &camera = layout.camera;
+	std::atomic_ref sequence(camera.sequence);
+
+	// The fence keeps the field stores below the odd sequence.
+	const uint32_t before = sequence.load(std::memory_order_relaxed);
+	sequence.store(before + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	const auto store = [](float &field, const float value){ std::atomic_ref(field).store(value, std::memory_order_relaxed); };
+	store(camera.viewAngles.x, update.viewAngles.x);
+	store(camera.viewAngles.y, update.viewAngles.y);
+	store(camera.viewAngles.z, update.viewAngles.z);
+	store(camera.origin.x, update.origin.x);
+	store(camera.origin.y, update.origin.y);
+	store(camera.origin.z, update.origin.z);
+	store(camera.curtime, update.curtime);
+
+	sequence.store(before + 2, std::memory_order_release);
+}
+
+// Reads of the camera register that may overlap a write before the reader gives up. A server that stopped
+// between its two sequence stores must not leave the reader spinning.
+constexpr int CAMERA_REGISTER_READ_ATTEMPTS = 8;
+
+// Client side: copies SharedMemoryLayout::camera into copy, retrying while the server is writing it.
+// Returns false, leaving a possibly torn copy, if no attempt read a consistent value.
+inline bool ReadCameraRegister(SharedMemoryLayout &layout, CameraRegister &copy)
+{
+	CameraRegister &camera = layout.camera;
+	std::atomic_ref sequence(camera.sequence);
+
+	const auto load = [](float &field){ return std::atomic_ref(field).load(std::memory_order_relaxed); };
+
+	for (int attempt = 0; attempt < CAMERA_REGISTER_READ_ATTEMPTS; attempt++)
+	{
+		copy.sequence     = sequence.load(std::memory_order_acquire);
+		copy.viewAngles.x = load(camera.viewAngles.x);
+		copy.viewAngles.y = load(camera.viewAngles.y);
+		copy.viewAngles.z = load(camera.viewAngles.z);
+		copy.origin.x     = load(camera.origin.x);
+		copy.origin.y     = load(camera.origin.y);
+		copy.origin.z     = load(camera.origin.z);
+		copy.curtime      = load(camera.curtime);
+
+		// Keeps the field loads above the second sequence load.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) == copy.sequence && (copy.sequence & 1) == 0)
+			return true;
+	}
+	return false;
+}
@@ -1,12 +1,35 @@
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <mutex>
+#include <bitset>
+#include <memory>
+#include <optional>
 #include <thread>
 #include <vector>
 
+#include "CameraState.h"
+#include "config.h"
+#include "DrawCommandStore.h"
+#include "DrawList.h"
+#include "IngestWaitStrategy.h"
+#include "RetainedObjectStore.h"
+#include "SeqLock.h"
 #include "SharedDefs.h"
-#include "Raylib/rlFPSCamera.h"
+#include "SharedMemoryTransport.h"
+#include "StringPool.h"
+#include "TripleBuffer.h"
+
+// How often the client had to recover from a corrupted stream, see SharedMemFeature::CHECKED_FRAMING,
+// and how often the server had to wake it, see SharedMemFeature::CLIENT_WAKE_STATE.
+struct IngestStats
+{
+	uint64_t checksumFailures; // Packets dropped because their CRC32C did not match, each also counts as a resync
+	uint64_t resyncs;          // Invalid packets dropped by skipping to the next sync word
+	uint64_t bytesSkipped;     // Bytes dropped while resynchronizing
+	uint64_t signalsSent;      // Signals the server sent because the client was about to block
+	uint64_t signalsElided;    // Waits that found data while polling, which the server did not signal
+};
 
 class SharedMemoryClient
 {
@@ -20,37 +43,127 @@ public:
 	SharedMemoryClient &operator=(SharedMemoryClient &&other) noexcept = delete;
 
 	// Connects to the shared memory and starts the listening thread.
-	bool Start(std::atomic<bool> &running, rlFPCamera &camera);
+	bool Start(std::atomic<bool> &running);
+
+	// Same as above, over the given transport rather than the default one for the platform.
+	bool Start(std::atomic<bool> &running, std::unique_ptr<SharedMemoryTransport> transport);
 
 	// Stops the thread and disconnects from shared memory.
 	void Stop();
 
-	// Gets the latest draw commands for the rendering loop.
-	std::vector<DrawCommandPacket> GetDrawCommands();
+	// How many consumed bytes the worker lets pile up before it publishes tail to the server, 0 for after every packet.
+	// Defaults to Config::TAIL_PUBLISH_BYTES. Only call while stopped.
+	void SetTailPublishBytes(const size_t bytes) { m_tailPublishBytes = bytes; }
+
+	// Gets the latest snapshot of the draw commands for the rendering loop, without copying or locking.
+	// Only call from the render thread. The snapshot stays valid until the next call.
+	const DrawSnapshot &GetDrawCommands();
+
+	// Gets the latest camera state, never waiting for the worker thread or the server.
+	// Returns false if the camera register was being written for too long to read it; keep the previous pose then.
+	// Only call from the render thread, once per frame.
+	bool GetCameraState(CameraState &state);
+
+	// Gets the framing recovery and signal counters so far. May be called from any thread.
+	[[nodiscard]] IngestStats GetStats() const;
 
 private:
-	void ClientThreadWorker(const std::atomic<bool> &running, rlFPCamera &camera);
+	// A retained list the worker thread brings up to date in place, once no snapshot refers to it anymore.
+	struct RetainedList
+	{
+		std::shared_ptr<DrawList> list;
+		std::vector<uint32_t>     pending;      // Objects updated since the list was last brought up to date
+		bool                      stale = true; // The objects changed in ways only a rebuild catches up with
+	};
+
+	RetainedList &AcquireRetainedList();
+
+	void ClientThreadWorker(const std::atomic<bool> &running);
 
-	void ProcessPacket(const PacketHeader &header, const std::byte *data, rlFPCamera &camera);
+	void ProcessPacket(const PacketHeader &header, const std::byte *data);
 
+	void AddDrawCommand(const DrawCommandPacket &cmd);
+	void AddDrawBatch(const DrawBatchHeader &batch, const std::byte *items);
+	void CreateRetainedObject(const RetainedCreateHeader &create, const std::byte *data, size_t size);
+	void UpdateRetainedObject(const RetainedUpdateData &update);
+	void DestroyRetainedObject(const RetainedDestroyData &destroy);
+	void ClearChannel(uint8_t channel);
+	void SetChannelVisible(uint8_t channel, bool visible);
 	void ExpireOldCommands();
 	void ClearDrawCommands();
+	void PublishDrawCommands();
+	void UpdateRetainedList();
 
-	void ReadFromBuffer(void *dest, size_t offset, size_t size) const;
+	StringPool::StringId InternText(const TextCommandData &text);
+	void                 ReplaceStringPool();
+	void                 RebuildStringPool();
+
+	void             ReadFromBuffer(void *dest, size_t offset, size_t size) const;
+	const std::byte *GetPacketData(size_t offset, size_t size);
+	const std::byte *ReadPacket(size_t offset, size_t available, PacketHeader &header, size_t &packetSize);
+	size_t           FindNextSyncWord(size_t offset, size_t available) const;
 
 	// Threading and synchronization
 	std::thread       m_clientThread;
 	std::atomic<bool> m_stopThread = false;
-	std::mutex        m_drawMutex;
 
-	// Handles for Windows objects
-	HANDLE              m_hMapFile   = nullptr;
-	HANDLE              m_hEvent     = nullptr;
-	SharedMemoryLayout *m_pSharedMem = nullptr;
+	IngestWaitStrategy m_waitStrategy;
+	size_t             m_tailPublishBytes = Config::TAIL_PUBLISH_BYTES; // See SetTailPublishBytes
+
+	// Platform specific mapping and signaling
+	std::unique_ptr<SharedMemoryTransport> m_transport;
+	SharedMemoryLayout *                   m_pSharedMem     = nullptr;
+	std::byte *                            m_pBuffer        = nullptr;
+	size_t                                 m_capacity       = 0;     // Buffer size negotiated at Start(), a power of 2
+	bool                                   m_ringMirrored   = false; // The buffer is mapped a second time directly behind itself
+	bool                                   m_checkedFraming = false; // The server uses FramedPacketHeader, see SharedMemFeature::CHECKED_FRAMING
+	bool                                   m_cameraRegister = false; // The server writes SharedMemoryLayout::camera, see SharedMemFeature::CAMERA_REGISTER
+
+	// Framing recovery counters, only written by the worker thread, see IngestStats
+	std::atomic<uint64_t> m_checksumFailures = 0;
+	std::atomic<uint64_t> m_resyncCount      = 0;
+	std::atomic<uint64_t> m_bytesSkipped     = 0;
+
+	// Local state, only touched by the worker thread
+	std::vector<std::byte> m_scratchBuffer; // Only used for packets that wrap around the end of the buffer
+	DrawCommandStore       m_drawCommands{Config::MAX_DRAW_COMMANDS, Config::DEDUPLICATE_DRAW_COMMANDS};
+	bool                   m_drawCommandsChanged = false; // The store changed since the last published snapshot
+	float                  m_currentTime         = 0.0f;
+
+	// Channel new draw commands and retained objects are filed under, and channels the server hid
+	uint8_t                         m_currentChannel = 0;
+	std::bitset<DRAW_CHANNEL_COUNT> m_hiddenChannels;
+
+	// Retained objects, and the draw list built from them the last time they changed.
+	// Updates to existing objects are patched into the lists, anything else rebuilds them.
+	RetainedObjectStore                                   m_retainedObjects{Config::MAX_RETAINED_OBJECTS};
+	std::shared_ptr<const DrawList>                       m_retainedList;
+	std::shared_ptr<const PrimitiveHierarchy>             m_retainedHierarchy;
+	std::array<RetainedList, Config::RETAINED_LIST_COUNT> m_retainedLists;
+	std::shared_ptr<std::vector<std::optional<PrimitiveRef>>> m_retainedPrimitives;  // Where each object is in the lists, per position in the store
+	std::vector<uint32_t>                                 m_retainedUpdates;         // Objects updated since the last publish
+	bool                                                  m_retainedChanged = false; // Objects were created, destroyed, shown or hidden
+	bool                                                  m_retainedMoved   = false; // An object was moved, the hierarchy changed
+
+	// Interned TEXT strings, shared with the snapshots that refer to them
+	std::shared_ptr<StringPool>              m_strings = std::make_shared<StringPool>(Config::MAX_INTERNED_STRINGS, Config::STRING_POOL_BYTES);
+	std::vector<std::shared_ptr<StringPool>> m_retiredStrings; // Pools replaced before, reused once no snapshot refers to them
+	std::vector<StringPool::StringId>        m_textIds = std::vector(Config::MAX_DRAW_COMMANDS, StringPool::INVALID_ID); // Per store slot
+
+	// Camera updates, kept by the worker thread and published to the render thread
+	CameraState          m_cameraHistory;
+	SeqLock<CameraState> m_cameraState;
+
+	// Camera updates read from the camera register, only touched by the render thread
+	CameraState m_registerHistory;
+	uint32_t    m_registerSequence = 0;
 
-	// Local state
-	std::vector<DrawCommandPacket> m_drawCommands;
-	float                          m_currentTime = 0.0f;
+	// Snapshots of m_drawCommands handed from the worker thread to the render thread
+	TripleBuffer<DrawSnapshot> m_drawSnapshots;
+	uint64_t                   m_listVersion = 0; // Last DrawList::version handed out
 
-	static constexpr size_t MAX_DRAW_COMMANDS = 2000;
+	static_assert(Config::MAX_DRAW_COMMANDS > 0 && Config::MAX_DRAW_COMMANDS < DrawCommandStore::INVALID_SLOT);
+	static_assert(Config::MAX_INTERNED_STRINGS > Config::MAX_DRAW_COMMANDS + Config::MAX_RETAINED_OBJECTS &&
+	              Config::STRING_POOL_BYTES > (Config::MAX_DRAW_COMMANDS + Config::MAX_RETAINED_OBJECTS) * sizeof(TextCommandData::text),
+	              "A fresh string pool must fit the text of every live command and retained object");
 };
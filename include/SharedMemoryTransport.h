@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "config.h"
+#include "SharedDefs.h"
+
+// The platform specific half of the shared memory client.
+// It maps the SharedMemoryLayout created by the server and waits for its new-data signal,
+// the head/tail ring protocol on top of it is the same on every platform.
+class SharedMemoryTransport
+{
+public:
+	// mirrored: try to map the buffer a second time behind itself, see IsMirrored().
+	explicit SharedMemoryTransport(const bool mirrored) : m_mirrorRequested(mirrored) { }
+	virtual ~SharedMemoryTransport() = default;
+
+	SharedMemoryTransport(const SharedMemoryTransport &other)                = delete;
+	SharedMemoryTransport(SharedMemoryTransport &&other) noexcept            = delete;
+	SharedMemoryTransport &operator=(const SharedMemoryTransport &other)     = delete;
+	SharedMemoryTransport &operator=(SharedMemoryTransport &&other) noexcept = delete;
+
+	// Opens and maps the objects created by the server. Prints the reason and returns false on failure.
+	virtual bool Open() = 0;
+
+	// Unmaps and closes everything opened by Open(). Safe to call more than once.
+	virtual void Close() = 0;
+
+	// Blocks until the server signals new data or the timeout expires.
+	// Returns true if the signal was received.
+	virtual bool WaitForData(uint32_t timeoutMs) = 0;
+
+	// Wakes up a thread blocked in WaitForData().
+	virtual void Wake() = 0;
+
+	// The mapped layout, or nullptr if not open.
+	[[nodiscard]] SharedMemoryLayout *GetLayout() const { return m_pSharedMem; }
+
+	// Size of the buffer behind the layout, as published by the server.
+	[[nodiscard]] size_t GetCapacity() const { return m_capacity; }
+
+	// True if the buffer is mapped a second time directly behind itself,
+	// meaning reads may run past the end of the buffer without wrapping.
+	[[nodiscard]] bool IsMirrored() const { return m_mirrored; }
+
+protected:
+	// Checks the protocol header the server put in front of the buffer.
+	// Prints the reason and returns false if we cannot talk to this server.
+	static bool ValidateHeader(SharedMemoryLayout &layout, size_t &capacity);
+
+	SharedMemoryLayout *m_pSharedMem      = nullptr;
+	size_t              m_capacity        = 0;
+	bool                m_mirrored        = false;
+	bool                m_mirrorRequested = false;
+};
+
+// Creates the transport for the platform we are built for.
+// Without mirrored, it always maps a single view and wrapped packets are copied out, as a fallback would.
+std::unique_ptr<SharedMemoryTransport> CreateSharedMemoryTransport(bool mirrored = Config::USE_MIRRORED_RING);
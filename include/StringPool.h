@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+// Append-only pool of interned, null-terminated strings addressed by a 32-bit id.
+// Interning a string that is already in the pool only costs a hash lookup.
+// Only the ingest thread interns. Strings never move once added, so any thread may read the ids
+// it was handed (e.g. through a published snapshot) while more strings are being appended.
+// The pool has a fixed capacity and is started over rather than compacted when it fills up.
+class StringPool
+{
+public:
+	using StringId = uint32_t;
+
+	static constexpr StringId INVALID_ID = UINT32_MAX;
+
+	StringPool(size_t maxStrings, size_t maxBytes);
+
+	// Returns the id of the string, adding it if needed, or INVALID_ID if the pool is full.
+	StringId Intern(std::string_view text);
+
+	// Removes every string, keeping the storage and the lookup's buckets for the next ones.
+	// Takes a new generation, as if the pool was replaced. Only call once no other thread reads from the pool.
+	void Reset();
+
+	[[nodiscard]] const char *Get(const StringId id) const { return m_characters.get() + m_offsets[id]; }
+
+	// Unique per pool instance and Reset, so caches keyed on ids can tell that the strings were replaced.
+	[[nodiscard]] uint64_t GetGeneration() const { return m_generation; }
+	[[nodiscard]] size_t   GetCount() const { return m_count; }
+
+private:
+	std::unique_ptr<uint32_t[]> m_offsets;    // Start of each string in m_characters
+	std::unique_ptr<char[]>     m_characters; // Null-terminated strings, back to back
+	size_t                      m_maxStrings;
+	size_t                      m_maxBytes;
+	size_t                      m_count     = 0;
+	size_t                      m_usedBytes = 0;
+	uint64_t                    m_generation;
+
+	std::unordered_map<std::string_view, StringId> m_lookup; // Views into m_characters
+};
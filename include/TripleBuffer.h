@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer triple buffer.
+// The producer fills the back buffer and publishes it by swapping it with the middle one,
+// the consumer swaps the middle one into the front when something new was published.
+// Neither side ever waits for the other or copies a value, and the consumer always sees
+// the most recently published value. Values are reused, so whatever storage they hold
+// stays allocated across swaps.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Producer side: the buffer to fill before calling Publish. Holds a value from two publishes ago.
+	T &GetBack() { return m_buffers[m_back]; }
+
+	// Producer side: makes the back buffer the latest value.
+	void Publish()
+	{
+		m_back = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer side: returns the latest published value. It stays valid and unchanged until the next call.
+	const T &Acquire()
+	{
+		// Only swap when the producer published since last time, so an idle producer costs one load.
+		if (m_middle.load(std::memory_order_relaxed) & FRESH_BIT)
+		{
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+		return m_buffers[m_front];
+	}
+
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT  = 0x4; // Set on m_middle when it holds a value the consumer has not seen
+
+	std::array<T, 3> m_buffers;
+
+	alignas(64) uint8_t              m_back   = 0; // Owned by the producer
+	alignas(64) std::atomic<uint8_t> m_middle = 1; // Shared between both sides
+	alignas(64) uint8_t              m_front  = 2; // Owned by the consumer
+};
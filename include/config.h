@@ -1,18 +1,54 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace Config
 {
+	// How the ingest thread waits for the server between ticks.
+	enum class IngestWaitMode : std::uint8_t
+	{
+		BLOCK,           // Always block on the transport's signal
+		SPIN_THEN_BLOCK, // Busy-poll head, then yield, then block
+		ADAPTIVE,        // Like SPIN_THEN_BLOCK, but sleeps through the quiet part of the observed tick interval first
+	};
+
 	// Application settings
 	constexpr int  TARGET_FPS           = 144;
 	constexpr auto OVERLAY_WINDOW_TITLE = "DebugOverlay";
 	constexpr auto TARGET_WINDOW_TITLE  = "Counter-Strike 2";
 
+	// Shared memory settings
+	constexpr bool   USE_MIRRORED_RING  = true;                           // Map the ring buffer twice so wrapped packets are contiguous
+	constexpr size_t TAIL_PUBLISH_BYTES = static_cast<size_t>(64) * 1024; // Release consumed ring space to the server at least every 64KB
+
+	// Ingest wait settings
+	// ADAPTIVE polls around the expected tick only, so most ticks need no signal (see IngestStats) while the thread
+	// sleeps for the rest of the interval. SPIN_THEN_BLOCK polls right after each drain instead and blocks by the tick.
+	constexpr IngestWaitMode INGEST_WAIT_MODE        = IngestWaitMode::ADAPTIVE;
+	constexpr int            INGEST_SPIN_BUDGET_US   = 50;  // Busy-poll head for this long before yielding
+	constexpr int            INGEST_YIELD_BUDGET_US  = 200; // Then poll with yields for this long before blocking
+	constexpr uint32_t       INGEST_BLOCK_TIMEOUT_MS = 30;  // Upper bound on a single block, in case a signal is missed
+
 	// Camera settings
-	constexpr float DEFAULT_FOV = 75.0f;
+	constexpr float DEFAULT_FOV              = 75.0f;
+	constexpr bool  CAMERA_EXTRAPOLATE       = false; // Predict the present pose instead of interpolating a tick behind
+	constexpr float CAMERA_MAX_EXTRAPOLATION = 1.0f;  // Ticks past the latest world update to extrapolate at most
+	constexpr float CAMERA_MAX_TICK_INTERVAL = 0.25f; // Seconds between world updates above which the latest one is shown as is
 
 	// Rendering settings
-	constexpr size_t MAX_DRAW_COMMANDS = 20000;
-	constexpr int    DEBUG_TEXT_SIZE   = 14;
+	constexpr size_t MAX_DRAW_COMMANDS         = 20000;
+	constexpr size_t MAX_RETAINED_OBJECTS      = 65536;
+	constexpr size_t RETAINED_LIST_COUNT       = 5; // Retained lists reused in turn: the snapshots and the latest one hold at most four
+	constexpr int    DEBUG_TEXT_SIZE           = 14;
+	constexpr bool   DEDUPLICATE_DRAW_COMMANDS = true; // Identical re-sent timed commands extend the stored one instead of adding a copy
+	constexpr size_t MAX_INTERNED_STRINGS      = (MAX_DRAW_COMMANDS + MAX_RETAINED_OBJECTS) * 2; // Distinct TEXT strings before the pool is rebuilt
+	constexpr size_t STRING_POOL_BYTES         = 16 * 1024 * 1024; // Must fit the text of every live command and retained object
+	constexpr size_t RETIRED_STRING_POOLS      = 4; // Replaced string pools kept for reuse: the snapshots hold at most three
+	constexpr bool   FRUSTUM_CULLING           = true;  // Drop primitives outside the view before they are uploaded and drawn
+	constexpr bool   SHOW_CULL_STATS           = false; // Draw the visible and culled primitive counts per type
+	constexpr float  PICK_LINE_DISTANCE        = 2.0f;  // How close the view ray has to pass a line to pick it
+	constexpr bool   HIGHLIGHT_PICKED          = false; // Outline the retained primitive under the crosshair
 
 	// Debug geometry settings
 	constexpr float DEBUG_CYLINDER_RADIUS = 20.0f;
@@ -1,8 +1,15 @@
 #pragma once
 
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
-#include "SharedDefs.h"
+#include "DrawList.h"
+#include "FrustumCuller.h"
+#include "InstanceBatcher.h"
+#include "LineBatcher.h"
+#include "ScreenProjector.h"
 #include "Raylib/rlFPSCamera.h"
 
 class OverlayRenderer
@@ -22,14 +29,47 @@ public:
 	void BeginFrame() const;
 	void EndFrame() const;
 
-	void RenderCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera) const;
+	void RenderCommands(const DrawSnapshot &snapshot, const rlFPCamera &camera);
 
 	static void RenderDebugInfo();
 	static bool ShouldClose();
 
 private:
-	static void Render3DCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera);
-	static void Render2DCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera);
+	static void Render3DCommands(const DrawList &commands, const Visibility *visibility);
+	static void RenderPickedPrimitive(const DrawList &retained, const rlFPCamera &camera);
+	void        RenderCullStats() const;
+	void        Render2DCommands(const DrawList &commands, const rlFPCamera &camera);
+
+	int  MeasureTextCached(const DrawList &commands, StringPool::StringId id, int fontSize);
+	void PruneTextWidths(const DrawSnapshot &snapshot);
+
+	// A measured string: ids are only unique within one pool, and the lists of a snapshot may use different pools.
+	struct TextWidthKey
+	{
+		uint64_t             generation;
+		StringPool::StringId id;
+		int                  fontSize;
+
+		bool operator==(const TextWidthKey &other) const = default;
+	};
+
+	struct TextWidthKeyHash
+	{
+		size_t operator()(const TextWidthKey &key) const;
+	};
 
 	bool m_initialized;
+
+	// Lines, spheres, circles and boxes of all lists, drawn in a few calls. Only exist while the window does.
+	std::unique_ptr<LineBatcher>     m_lineBatcher;
+	std::unique_ptr<InstanceBatcher> m_instanceBatcher;
+
+	FrustumCuller m_frustumCuller;
+
+	// World texts of the list being drawn that are on screen, reused across frames
+	ProjectedPoints m_projectedTexts;
+
+	// MeasureText results of the string pools in m_textWidthsGenerations, dropped once a pool is no longer drawn from
+	std::unordered_map<TextWidthKey, int, TextWidthKeyHash> m_textWidths;
+	std::array<uint64_t, 2>                                 m_textWidthsGenerations = {};
 };
@@ -82,4 +82,13 @@ typedef struct tagBITMAPINFOHEADER
 extern "C" HWND WINAPI FindWindowA(LPCSTR lpClassName, LPCSTR lpWindowName);
 extern "C" BOOL WINAPI GetWindowRect(HWND hWnd, LPRECT lpRect);
 
+// OpenGL 1.1 function declarations (opengl32.lib), for draws rlgl has no call for.
+// Newer entry points have to be loaded through wglGetProcAddress.
+extern "C" void WINAPI glDrawArrays(unsigned int mode, int first, int count);
+extern "C" void WINAPI glDrawElements(unsigned int mode, int count, unsigned int type, const void *indices);
+extern "C" void WINAPI glGenTextures(int n, unsigned int *textures);
+extern "C" void WINAPI glDeleteTextures(int n, const unsigned int *textures);
+extern "C" void WINAPI glBindTexture(unsigned int target, unsigned int texture);
+extern "C" PROC WINAPI wglGetProcAddress(LPCSTR lpszProc);
+
 #endif // _WIN32
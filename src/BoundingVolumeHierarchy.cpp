@@ -0,0 +1,422 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+
+#include "Raylib/raymath.h"
+
+namespace
+{
+	BoundingBox Combine(const BoundingBox &a, const BoundingBox &b)
+	{
+		return {Vector3Min(a.min, b.min), Vector3Max(a.max, b.max)};
+	}
+
+	// The cost of a box for the insertion heuristic: how likely a random query is to touch it.
+	float GetSurfaceArea(const BoundingBox &box)
+	{
+		const Vector3 size = Vector3Subtract(box.max, box.min);
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool IsSameBox(const BoundingBox &a, const BoundingBox &b)
+	{
+		return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+		       a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+	}
+
+	enum class Containment : uint8_t
+	{
+		OUTSIDE,
+		INTERSECTING,
+		INSIDE,
+	};
+
+	Containment Classify(const BoundingBox &box, const Frustum &frustum)
+	{
+		Containment containment = Containment::INSIDE;
+		for (const Vector4 &plane : frustum.planes)
+		{
+			// The corners furthest along and against the plane normal.
+			const Vector3 positive = {plane.x >= 0.0f ? box.max.x : box.min.x,
+			                          plane.y >= 0.0f ? box.max.y : box.min.y,
+			                          plane.z >= 0.0f ? box.max.z : box.min.z};
+			const Vector3 negative = {plane.x >= 0.0f ? box.min.x : box.max.x,
+			                          plane.y >= 0.0f ? box.min.y : box.max.y,
+			                          plane.z >= 0.0f ? box.min.z : box.max.z};
+
+			if (positive.x * plane.x + positive.y * plane.y + positive.z * plane.z + plane.w < 0.0f)
+				return Containment::OUTSIDE;
+			if (negative.x * plane.x + negative.y * plane.y + negative.z * plane.z + plane.w < 0.0f)
+				containment = Containment::INTERSECTING;
+		}
+		return containment;
+	}
+}
+
+int32_t BoundingVolumeHierarchy::Insert(const BoundingBox &box, const uint32_t payload)
+{
+	const int32_t leaf = AllocateNode();
+	Node &        node = EditNode(leaf);
+	node.box           = box;
+	node.payload       = payload;
+	node.height        = 0;
+
+	InsertLeaf(leaf);
+	m_leafCount++;
+	return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(const int32_t leaf)
+{
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	m_leafCount--;
+}
+
+void BoundingVolumeHierarchy::Move(const int32_t leaf, const BoundingBox &box)
+{
+	if (IsSameBox(GetNode(leaf).box, box))
+		return;
+
+	RemoveLeaf(leaf);
+	EditNode(leaf).box = box;
+	InsertLeaf(leaf);
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	m_chunks.clear();
+	m_nodeCount = 0;
+	m_root      = NULL_NODE;
+	m_freeList  = NULL_NODE;
+	m_leafCount = 0;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &payloads) const
+{
+	if (m_root != NULL_NODE)
+	{
+		QueryNode(m_root, frustum, false, payloads);
+	}
+}
+
+/**
+ * \brief Takes a node off the free list, or adds one.
+ */
+int32_t BoundingVolumeHierarchy::AllocateNode()
+{
+	if (m_freeList == NULL_NODE)
+	{
+		if (m_nodeCount == m_chunks.size() * CHUNK_SIZE)
+		{
+			m_chunks.push_back(std::make_shared<Chunk>());
+		}
+		const auto node = static_cast<int32_t>(m_nodeCount++);
+		EditNode(node)  = {};
+		return node;
+	}
+
+	const int32_t node = m_freeList;
+	m_freeList         = GetNode(node).parent;
+	EditNode(node)     = {};
+	return node;
+}
+
+void BoundingVolumeHierarchy::FreeNode(const int32_t node)
+{
+	Node &freed  = EditNode(node);
+	freed.parent = m_freeList;
+	freed.height = -1;
+	m_freeList   = node;
+}
+
+/**
+ * \brief Copies the chunk of a node first if another tree still shares it.
+ */
+BoundingVolumeHierarchy::Node &BoundingVolumeHierarchy::EditNode(const int32_t node)
+{
+	std::shared_ptr<Chunk> &chunk = m_chunks[node / CHUNK_SIZE];
+	if (chunk.use_count() > 1)
+	{
+		chunk = std::make_shared<Chunk>(*chunk);
+	}
+	else
+	{
+		// The other trees may have let go of it from another thread, see their reads before writing.
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return (*chunk)[node % CHUNK_SIZE];
+}
+
+/**
+ * \brief Links a leaf in next to the node that grows the least in surface area by taking it in,
+ * then refits and rebalances its ancestors.
+ */
+void BoundingVolumeHierarchy::InsertLeaf(const int32_t leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root                = leaf;
+		EditNode(leaf).parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down towards the cheapest sibling. The cost of going down a level is the area the leaf
+	// would add to the node there, plus what every ancestor already grows by on the way.
+	const BoundingBox leafBox = GetNode(leaf).box;
+	int32_t           sibling = m_root;
+	while (!GetNode(sibling).IsLeaf())
+	{
+		const Node &node         = GetNode(sibling);
+		const float area         = GetSurfaceArea(node.box);
+		const float combinedArea = GetSurfaceArea(Combine(node.box, leafBox));
+
+		const float siblingCost     = 2.0f * combinedArea;          // Pair the leaf with this node
+		const float inheritanceCost = 2.0f * (combinedArea - area); // Growth of this node if the leaf goes further down
+
+		const auto descendCost = [&](const int32_t child)
+		{
+			const Node &childNode = GetNode(child);
+			const float grown     = GetSurfaceArea(Combine(leafBox, childNode.box));
+			return (childNode.IsLeaf() ? grown : grown - GetSurfaceArea(childNode.box)) + inheritanceCost;
+		};
+
+		const float cost1 = descendCost(node.child1);
+		const float cost2 = descendCost(node.child2);
+		if (siblingCost < cost1 && siblingCost < cost2)
+			break;
+
+		sibling = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	// A new parent takes the place of the sibling and holds it and the leaf.
+	const int32_t oldParent = GetNode(sibling).parent;
+	const int32_t newParent = AllocateNode();
+	Node &        parent    = EditNode(newParent);
+	parent.parent           = oldParent;
+	parent.child1           = sibling;
+	parent.child2           = leaf;
+	parent.box              = Combine(leafBox, GetNode(sibling).box);
+	parent.height           = GetNode(sibling).height + 1;
+
+	if (oldParent == NULL_NODE)
+	{
+		m_root = newParent;
+	}
+	else if (GetNode(oldParent).child1 == sibling)
+	{
+		EditNode(oldParent).child1 = newParent;
+	}
+	else
+	{
+		EditNode(oldParent).child2 = newParent;
+	}
+	EditNode(sibling).parent = newParent;
+	EditNode(leaf).parent    = newParent;
+
+	Refit(newParent);
+}
+
+/**
+ * \brief Unlinks a leaf, putting its sibling in place of their parent, then refits and rebalances the ancestors.
+ * The leaf node itself is left allocated.
+ */
+void BoundingVolumeHierarchy::RemoveLeaf(const int32_t leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	const int32_t parent      = GetNode(leaf).parent;
+	const int32_t grandParent = GetNode(parent).parent;
+	const int32_t sibling     = GetNode(parent).child1 == leaf ? GetNode(parent).child2 : GetNode(parent).child1;
+
+	FreeNode(parent);
+	EditNode(sibling).parent = grandParent;
+
+	if (grandParent == NULL_NODE)
+	{
+		m_root = sibling;
+		return;
+	}
+
+	if (GetNode(grandParent).child1 == parent)
+	{
+		EditNode(grandParent).child1 = sibling;
+	}
+	else
+	{
+		EditNode(grandParent).child2 = sibling;
+	}
+	Refit(grandParent);
+}
+
+/**
+ * \brief Recomputes the boxes and heights from a node up to the root, rebalancing each node on the way.
+ */
+void BoundingVolumeHierarchy::Refit(int32_t node)
+{
+	while (node != NULL_NODE)
+	{
+		node = Balance(node);
+
+		Node &      current = EditNode(node);
+		const Node &child1  = GetNode(current.child1);
+		const Node &child2  = GetNode(current.child2);
+		current.height      = 1 + std::max(child1.height, child2.height);
+		current.box         = Combine(child1.box, child2.box);
+
+		node = current.parent;
+	}
+}
+
+/**
+ * \brief Rotates the taller child of a node up in its place if its children differ in height by more than one.
+ * \return The node now at the place of the given one.
+ */
+int32_t BoundingVolumeHierarchy::Balance(const int32_t iA)
+{
+	if (GetNode(iA).IsLeaf() || GetNode(iA).height < 2)
+		return iA;
+
+	// Every node a rotation may touch is taken through EditNode, so the references stay valid throughout.
+	Node &        a       = EditNode(iA);
+	const int32_t iB      = a.child1;
+	const int32_t iC      = a.child2;
+	Node &        b       = EditNode(iB);
+	Node &        c       = EditNode(iC);
+	const int32_t balance = c.height - b.height;
+
+	// Puts the rotated up node in place of A in A's parent.
+	const auto replaceInParent = [&](Node &up, const int32_t iUp)
+	{
+		up.parent = a.parent;
+		a.parent  = iUp;
+		if (up.parent == NULL_NODE)
+		{
+			m_root = iUp;
+		}
+		else if (Node &upParent = EditNode(up.parent); upParent.child1 == iA)
+		{
+			upParent.child1 = iUp;
+		}
+		else
+		{
+			upParent.child2 = iUp;
+		}
+	};
+
+	// C is taller: C goes up, A takes the shorter child of C and C keeps the taller one.
+	if (balance > 1)
+	{
+		const int32_t iF = c.child1;
+		const int32_t iG = c.child2;
+		Node &        f  = EditNode(iF);
+		Node &        g  = EditNode(iG);
+
+		c.child1 = iA;
+		replaceInParent(c, iC);
+
+		const bool    keepF  = f.height > g.height;
+		const int32_t iKept  = keepF ? iF : iG;
+		const int32_t iMoved = keepF ? iG : iF;
+		Node &        kept   = EditNode(iKept);
+		Node &        moved  = EditNode(iMoved);
+
+		c.child2     = iKept;
+		a.child2     = iMoved;
+		moved.parent = iA;
+		a.box        = Combine(b.box, moved.box);
+		c.box        = Combine(a.box, kept.box);
+		a.height     = 1 + std::max(b.height, moved.height);
+		c.height     = 1 + std::max(a.height, kept.height);
+		return iC;
+	}
+
+	// B is taller: the same the other way around.
+	if (balance < -1)
+	{
+		const int32_t iD = b.child1;
+		const int32_t iE = b.child2;
+		Node &        d  = EditNode(iD);
+		Node &        e  = EditNode(iE);
+
+		b.child1 = iA;
+		replaceInParent(b, iB);
+
+		const bool    keepD  = d.height > e.height;
+		const int32_t iKept  = keepD ? iD : iE;
+		const int32_t iMoved = keepD ? iE : iD;
+		Node &        kept   = EditNode(iKept);
+		Node &        moved  = EditNode(iMoved);
+
+		b.child2     = iKept;
+		a.child1     = iMoved;
+		moved.parent = iA;
+		a.box        = Combine(c.box, moved.box);
+		b.box        = Combine(a.box, kept.box);
+		a.height     = 1 + std::max(c.height, moved.height);
+		b.height     = 1 + std::max(a.height, kept.height);
+		return iB;
+	}
+
+	return iA;
+}
+
+/**
+ * \brief Collects the leaves below a node that touch the frustum. Below a node entirely inside it,
+ * every leaf is taken without testing.
+ */
+void BoundingVolumeHierarchy::QueryNode(const int32_t node, const Frustum &frustum, bool inside, std::vector<uint32_t> &payloads) const
+{
+	const Node &current = GetNode(node);
+	if (!inside)
+	{
+		const Containment containment = Classify(current.box, frustum);
+		if (containment == Containment::OUTSIDE)
+			return;
+		inside = containment == Containment::INSIDE;
+	}
+
+	if (current.IsLeaf())
+	{
+		payloads.push_back(current.payload);
+		return;
+	}
+
+	QueryNode(current.child1, frustum, inside, payloads);
+	QueryNode(current.child2, frustum, inside, payloads);
+}
+
+float BoundingVolumeHierarchy::GetEntryDistance(const BoundingBox &box, const Ray &ray, const float margin)
+{
+	// Slab test: the ray is inside the box between the last plane it enters and the first one it leaves.
+	const float origin[]    = {ray.position.x, ray.position.y, ray.position.z};
+	const float direction[] = {ray.direction.x, ray.direction.y, ray.direction.z};
+	const float mins[]      = {box.min.x - margin, box.min.y - margin, box.min.z - margin};
+	const float maxs[]      = {box.max.x + margin, box.max.y + margin, box.max.z + margin};
+
+	float entry = 0.0f;
+	float exit  = INFINITY;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (fabsf(direction[axis]) < EPSILON)
+		{
+			// Parallel to the slab, which the ray is then either always or never in.
+			if (origin[axis] < mins[axis] || origin[axis] > maxs[axis])
+				return INFINITY;
+			continue;
+		}
+
+		const float inverse = 1.0f / direction[axis];
+		const float toMin   = (mins[axis] - origin[axis]) * inverse;
+		const float toMax   = (maxs[axis] - origin[axis]) * inverse;
+		entry               = fmaxf(entry, fminf(toMin, toMax));
+		exit                = fminf(exit, fmaxf(toMin, toMax));
+		if (entry > exit)
+			return INFINITY;
+	}
+	return entry;
+}
@@ -0,0 +1,78 @@
+#include "CameraState.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "config.h"
+
+namespace
+{
+	float Lerp(const float from, const float to, const float t)
+	{
+		return from + (to - from) * t;
+	}
+
+	CameraPose MakePose(const Vector &origin, const QAngle &viewAngles)
+	{
+		return {
+			.position = origin.ToRayLib(),
+			.viewAngles = {
+				.x = -viewAngles.y * DEG2RAD,
+				.y = viewAngles.x * DEG2RAD,
+			},
+		};
+	}
+}
+
+void CameraState::Push(const WorldUpdatePacket &update, const Clock::time_point receivedAt)
+{
+	if (m_count > 0 && update.curtime > m_latest.curtime)
+	{
+		m_previous = m_latest;
+		m_count    = 2;
+	}
+	else if (m_count == 0 || update.curtime < m_latest.curtime)
+	{
+		// First update, or the server restarted.
+		m_count = 1;
+	}
+
+	m_latest = {
+		.viewAngles = update.viewAngles,
+		.origin = update.origin,
+		.curtime = update.curtime,
+		.receivedAt = receivedAt,
+	};
+}
+
+CameraPose CameraState::GetPose(const Clock::time_point now, const bool extrapolate) const
+{
+	const float interval = m_latest.curtime - m_previous.curtime;
+
+	// Nothing to blend with, or the server stalled for long enough that blending would only smear a jump.
+	if (m_count < 2 || !(interval > 0.0f) || interval > Config::CAMERA_MAX_TICK_INTERVAL)
+		return MakePose(m_latest.origin, m_latest.viewAngles);
+
+	// Game time passed since the latest update, estimated from when we received it, in ticks.
+	const float elapsed = std::chrono::duration<float>(now - m_latest.receivedAt).count() / interval;
+
+	// t = 0 is the previous update, t = 1 the latest one.
+	const float t = extrapolate
+		                ? 1.0f + std::clamp(elapsed, 0.0f, Config::CAMERA_MAX_EXTRAPOLATION)
+		                : std::clamp(elapsed, 0.0f, 1.0f);
+
+	// Turn the short way around when the yaw wraps at +-180 degrees.
+	const float yawDelta = std::remainder(m_latest.viewAngles.y - m_previous.viewAngles.y, 360.0f);
+
+	const Vector origin = {
+		.x = Lerp(m_previous.origin.x, m_latest.origin.x, t),
+		.y = Lerp(m_previous.origin.y, m_latest.origin.y, t),
+		.z = Lerp(m_previous.origin.z, m_latest.origin.z, t),
+	};
+	const QAngle viewAngles = {
+		.x = Lerp(m_previous.viewAngles.x, m_latest.viewAngles.x, t),
+		.y = m_previous.viewAngles.y + yawDelta * t,
+		.z = 0.0f,
+	};
+	return MakePose(origin, viewAngles);
+}
@@ -0,0 +1,100 @@
+#include "Crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRC32C_HAS_SSE42_PATH
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <nmmintrin.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // Castagnoli, bit-reflected
+
+	constexpr std::array<uint32_t, 256> CRC32C_TABLE = []
+	{
+		std::array<uint32_t, 256> table = {};
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+			}
+			table[i] = crc;
+		}
+		return table;
+	}();
+
+	uint32_t Crc32cSoftware(uint32_t crc, const unsigned char *data, size_t size)
+	{
+		while (size--)
+		{
+			crc = CRC32C_TABLE[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+#if defined(CRC32C_HAS_SSE42_PATH)
+#if !defined(_MSC_VER)
+	__attribute__((target("sse4.2")))
+#endif
+	uint32_t Crc32cHardware(uint32_t crc, const unsigned char *data, size_t size)
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		uint64_t crc64 = crc;
+		for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t))
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			crc64 = _mm_crc32_u64(crc64, value);
+		}
+		crc = static_cast<uint32_t>(crc64);
+#endif
+		for (; size >= sizeof(uint32_t); data += sizeof(uint32_t), size -= sizeof(uint32_t))
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			crc = _mm_crc32_u32(crc, value);
+		}
+
+		while (size--)
+		{
+			crc = _mm_crc32_u8(crc, *data++);
+		}
+		return crc;
+	}
+
+	bool HasSse42()
+	{
+		constexpr unsigned SSE42_BIT = 1u << 20; // CPUID leaf 1, ECX
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (static_cast<unsigned>(info[2]) & SSE42_BIT) != 0;
+#else
+		unsigned eax, ebx, ecx, edx;
+		return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & SSE42_BIT) != 0;
+#endif
+	}
+#endif
+}
+
+uint32_t ComputeCrc32c(const void *data, const size_t size, const uint32_t crc)
+{
+	const auto *bytes = static_cast<const unsigned char*>(data);
+
+#if defined(CRC32C_HAS_SSE42_PATH)
+	static const bool hasSse42 = HasSse42();
+	if (hasSse42)
+		return ~Crc32cHardware(~crc, bytes, size);
+#endif
+
+	return ~Crc32cSoftware(~crc, bytes, size);
+}
@@ -0,0 +1,494 @@
+#include "DrawCommandStore.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+
+namespace
+{
+	// Number of meaningful bytes at the start of the command data union.
+	size_t GetContentSize(const DrawCommandPacket &cmd)
+	{
+		switch (cmd.type)
+		{
+			case DrawCommandType::LINE:
+				return sizeof(LineCommandData);
+			case DrawCommandType::TRIANGLE:
+				return sizeof(TriangleCommandData);
+			case DrawCommandType::SPHERE:
+				return sizeof(SphereCommandData);
+			case DrawCommandType::CIRCLE:
+				return sizeof(CircleCommandData);
+			case DrawCommandType::BBOX:
+				return sizeof(BBoxCommandData);
+			case DrawCommandType::TEXT:
+				return offsetof(TextCommandData, text) + strnlen(cmd.text.text, sizeof(cmd.text.text) - 1);
+			default:  // NOLINT(clang-diagnostic-covered-switch-default)
+				return 0;
+		}
+	}
+}
+
+DrawCommandStore::DrawCommandStore(const size_t capacity, const bool deduplicate)
+	: m_slots(std::make_unique<Slot[]>(capacity)),
+	  m_capacity(capacity),
+	  m_deduplicate(deduplicate)
+{
+	// Stale entries are compacted away before the heap outgrows twice the capacity, see TrackExpiry.
+	m_expiryHeap.reserve(capacity * 2);
+	m_transient.reserve(capacity);
+	m_batchPending.reserve(capacity);
+	if (deduplicate)
+	{
+		// At most one entry per slot, so the table stays at most half full and probe sequences short.
+		const size_t entries = std::bit_ceil(capacity * 2);
+		m_contentIndex       = std::make_unique<ContentEntry[]>(entries);
+		m_contentMask        = entries - 1;
+	}
+	Clear();
+}
+
+DrawCommandStore::SlotIndex DrawCommandStore::Insert(const uint8_t channel, const DrawCommandPacket &cmd)
+{
+	// One-frame commands are gone by the next tick anyway, only timed ones are worth deduplicating.
+	const bool     hashed = m_deduplicate && cmd.drawEndTime > 0.0f;
+	const uint32_t hash   = hashed ? HashContent(channel, cmd) : 0;
+
+	if (hashed)
+	{
+		if (const SlotIndex stored = FindStored(hash, channel, cmd); stored != INVALID_SLOT)
+		{
+			ExtendExpiry(stored, cmd.drawEndTime);
+
+			// Treat it as new for eviction, it is still being sent.
+			Unlink(stored);
+			LinkNewest(stored);
+
+			m_duplicateCount++;
+			return stored;
+		}
+	}
+
+	const SlotIndex slot = AcquireSlot();
+	PlaceCommand(slot, channel, cmd, hashed, hash);
+	TrackExpiry(slot);
+	return slot;
+}
+
+/**
+ * \brief Looks a command of a batch up among the stored ones, before any of the batch is added.
+ * A stored command it repeats is made the newest right away, so making room for the batch does not evict it.
+ */
+DrawCommandStore::PendingCommand DrawCommandStore::FindBatchDuplicate(const uint8_t channel, const DrawCommandPacket &cmd)
+{
+	const bool      hashed = m_deduplicate && cmd.drawEndTime > 0.0f;
+	const uint32_t  hash   = hashed ? HashContent(channel, cmd) : 0;
+	const SlotIndex stored = hashed ? FindStored(hash, channel, cmd) : INVALID_SLOT;
+	if (stored != INVALID_SLOT)
+	{
+		Unlink(stored);
+		LinkNewest(stored);
+	}
+	return {stored, hash, hashed, false};
+}
+
+/**
+ * \brief Evicts the oldest commands until at least count slots are free.
+ */
+void DrawCommandStore::ReserveSlots(const size_t count)
+{
+	while (m_capacity - m_size < count)
+	{
+		Remove(m_oldest);
+	}
+}
+
+/**
+ * \brief Adds a command of a batch as Insert does, but leaves its expiry entry to TrackBatchExpiry.
+ */
+void DrawCommandStore::AddBatchCommand(const uint8_t channel, const DrawCommandPacket &cmd, PendingCommand &pending)
+{
+	// A command repeating an earlier one of the same batch is only found now.
+	if (pending.hashed && pending.slot == INVALID_SLOT)
+	{
+		pending.slot = FindStored(pending.contentHash, channel, cmd);
+	}
+
+	if (pending.slot != INVALID_SLOT)
+	{
+		DrawCommandPacket &stored = m_slots[pending.slot].cmd;
+		if (cmd.drawEndTime > stored.drawEndTime)
+		{
+			stored.drawEndTime = cmd.drawEndTime;
+			pending.tracked    = true;
+		}
+
+		Unlink(pending.slot);
+		LinkNewest(pending.slot);
+
+		m_duplicateCount++;
+		return;
+	}
+
+	pending.slot    = AcquireSlot();
+	pending.tracked = true;
+	PlaceCommand(pending.slot, channel, cmd, pending.hashed, pending.contentHash);
+}
+
+/**
+ * \brief Stores a command in a slot taken off the free list and links it as the newest command.
+ */
+void DrawCommandStore::PlaceCommand(const SlotIndex slot, const uint8_t channel, const DrawCommandPacket &cmd, const bool hashed, const uint32_t hash)
+{
+	new (&m_slots[slot].cmd) DrawCommandPacket(cmd);
+	LinkNewest(slot);
+	LinkChannel(slot, channel);
+
+	m_slots[slot].hashed      = hashed;
+	m_slots[slot].contentHash = hash;
+	if (hashed)
+	{
+		// Replaces a colliding entry, whose slot then simply is no longer found by content.
+		SetContent(hash, slot);
+	}
+
+	m_insertCount++;
+}
+
+void DrawCommandStore::Remove(const SlotIndex slot)
+{
+	Unlink(slot);
+	UnlinkChannel(slot);
+
+	if (m_slots[slot].hashed)
+	{
+		EraseContent(m_slots[slot].contentHash, slot);
+		m_slots[slot].hashed = false;
+	}
+
+	m_slots[slot].generation++;
+	m_slots[slot].next = m_freeList;
+	m_freeList         = slot;
+}
+
+void DrawCommandStore::Clear()
+{
+	// Thread every slot onto the free list in order, so a fresh store fills the slab front to back.
+	for (size_t i = 0; i < m_capacity; i++)
+	{
+		m_slots[i].prev = INVALID_SLOT;
+		m_slots[i].next = i + 1 < m_capacity ? static_cast<SlotIndex>(i + 1) : INVALID_SLOT;
+		m_slots[i].generation++;
+		m_slots[i].hashed = false;
+	}
+
+	m_channelHeads.fill(INVALID_SLOT);
+	if (m_contentIndex)
+	{
+		std::fill_n(m_contentIndex.get(), m_contentMask + 1, ContentEntry{});
+	}
+	m_expiryHeap.clear();
+	m_transient.clear();
+
+	m_freeList = 0;
+	m_oldest   = INVALID_SLOT;
+	m_newest   = INVALID_SLOT;
+	m_size     = 0;
+}
+
+size_t DrawCommandStore::RemoveChannel(const uint8_t channel)
+{
+	size_t removed = 0;
+	while (m_channelHeads[channel] != INVALID_SLOT)
+	{
+		Remove(m_channelHeads[channel]);
+		removed++;
+	}
+	return removed;
+}
+
+size_t DrawCommandStore::RemoveExpired(const float currentTime)
+{
+	size_t removed = 0;
+
+	// A command with duration 0 should be rendered for one frame,
+	// so it goes once we have any newer time.
+	if (currentTime > 0.0f)
+	{
+		for (const ExpiryEntry &entry : m_transient)
+		{
+			if (IsLive(entry))
+			{
+				Remove(entry.slot);
+				removed++;
+			}
+		}
+		m_transient.clear();
+	}
+
+	while (!m_expiryHeap.empty() && m_expiryHeap.front().endTime <= currentTime)
+	{
+		std::ranges::pop_heap(m_expiryHeap, std::greater());
+		const ExpiryEntry entry = m_expiryHeap.back();
+		m_expiryHeap.pop_back();
+
+		if (IsCurrent(entry))
+		{
+			Remove(entry.slot);
+			removed++;
+		}
+	}
+
+	return removed;
+}
+
+/**
+ * \brief Takes a slot off the free list, evicting the oldest command first if there is none.
+ * \return A slot that is on neither list.
+ */
+DrawCommandStore::SlotIndex DrawCommandStore::AcquireSlot()
+{
+	if (m_freeList == INVALID_SLOT)
+	{
+		Remove(m_oldest);
+	}
+
+	const SlotIndex slot = m_freeList;
+	m_freeList           = m_slots[slot].next;
+	return slot;
+}
+
+void DrawCommandStore::LinkNewest(const SlotIndex slot)
+{
+	m_slots[slot].prev = m_newest;
+	m_slots[slot].next = INVALID_SLOT;
+
+	if (m_newest != INVALID_SLOT)
+		m_slots[m_newest].next = slot;
+	else
+		m_oldest = slot;
+
+	m_newest = slot;
+	m_size++;
+}
+
+void DrawCommandStore::LinkChannel(const SlotIndex slot, const uint8_t channel)
+{
+	m_slots[slot].channel     = channel;
+	m_slots[slot].channelPrev = INVALID_SLOT;
+	m_slots[slot].channelNext = m_channelHeads[channel];
+
+	if (m_channelHeads[channel] != INVALID_SLOT)
+		m_slots[m_channelHeads[channel]].channelPrev = slot;
+
+	m_channelHeads[channel] = slot;
+}
+
+void DrawCommandStore::Unlink(const SlotIndex slot)
+{
+	const SlotIndex prev = m_slots[slot].prev;
+	const SlotIndex next = m_slots[slot].next;
+
+	if (prev != INVALID_SLOT)
+		m_slots[prev].next = next;
+	else
+		m_oldest = next;
+
+	if (next != INVALID_SLOT)
+		m_slots[next].prev = prev;
+	else
+		m_newest = prev;
+
+	m_size--;
+}
+
+void DrawCommandStore::UnlinkChannel(const SlotIndex slot)
+{
+	const SlotIndex channelPrev = m_slots[slot].channelPrev;
+	const SlotIndex channelNext = m_slots[slot].channelNext;
+
+	if (channelPrev != INVALID_SLOT)
+		m_slots[channelPrev].channelNext = channelNext;
+	else
+		m_channelHeads[m_slots[slot].channel] = channelNext;
+
+	if (channelNext != INVALID_SLOT)
+		m_slots[channelNext].channelPrev = channelPrev;
+}
+
+void DrawCommandStore::TrackExpiry(const SlotIndex slot)
+{
+	const ExpiryEntry entry = {m_slots[slot].cmd.drawEndTime, slot, m_slots[slot].generation};
+
+	// Anything that is not a positive end time (including NaN) is treated as a one-frame command.
+	if (!(entry.endTime > 0.0f))
+	{
+		if (m_transient.size() == m_capacity)
+		{
+			std::erase_if(m_transient, [this](const ExpiryEntry &e){ return !IsLive(e); });
+		}
+		m_transient.push_back(entry);
+		return;
+	}
+
+	// Evicted and cleared commands leave stale entries behind. Drop them before the heap would reallocate.
+	if (m_expiryHeap.size() == m_expiryHeap.capacity())
+	{
+		CompactExpiryHeap();
+	}
+
+	m_expiryHeap.push_back(entry);
+	std::ranges::push_heap(m_expiryHeap, std::greater());
+}
+
+/**
+ * \brief Indexes the expiry of the commands InsertBatch added or extended, as TrackExpiry does one by one,
+ * but making room for all of them at once and rebuilding the heap when that is cheaper than pushing each.
+ */
+void DrawCommandStore::TrackBatchExpiry()
+{
+	const size_t count = m_batchPending.size();
+	if (m_transient.size() + count > m_capacity)
+	{
+		std::erase_if(m_transient, [this](const ExpiryEntry &e){ return !IsLive(e); });
+	}
+	if (m_expiryHeap.size() + count > m_expiryHeap.capacity())
+	{
+		CompactExpiryHeap();
+	}
+
+	const size_t heapSize = m_expiryHeap.size();
+	for (const PendingCommand &pending : m_batchPending)
+	{
+		if (!pending.tracked)
+			continue;
+
+		const ExpiryEntry entry = {m_slots[pending.slot].cmd.drawEndTime, pending.slot, m_slots[pending.slot].generation};
+		if (entry.endTime > 0.0f)
+			m_expiryHeap.push_back(entry);
+		else
+			m_transient.push_back(entry);
+	}
+
+	if (m_expiryHeap.size() - heapSize > heapSize)
+	{
+		std::ranges::make_heap(m_expiryHeap, std::greater());
+		return;
+	}
+	for (auto end = m_expiryHeap.begin() + static_cast<ptrdiff_t>(heapSize); end != m_expiryHeap.end(); ++end)
+	{
+		std::push_heap(m_expiryHeap.begin(), end + 1, std::greater());
+	}
+}
+
+/**
+ * \brief Pushes the end time of a timed command back. Its previous heap entry goes stale.
+ */
+void DrawCommandStore::ExtendExpiry(const SlotIndex slot, const float endTime)
+{
+	if (!(endTime > m_slots[slot].cmd.drawEndTime))
+		return;
+
+	m_slots[slot].cmd.drawEndTime = endTime;
+	TrackExpiry(slot);
+}
+
+void DrawCommandStore::CompactExpiryHeap()
+{
+	std::erase_if(m_expiryHeap, [this](const ExpiryEntry &entry){ return !IsCurrent(entry); });
+	std::ranges::make_heap(m_expiryHeap, std::greater());
+}
+
+uint32_t DrawCommandStore::HashContent(const uint8_t channel, const DrawCommandPacket &cmd)
+{
+	const struct
+	{
+		uint8_t         channel;
+		DrawCommandType type;
+		Color           color;
+	} key = {channel, cmd.type, cmd.color};
+
+	// Hashes only the fields, the struct padding is not initialized.
+	uint32_t hash = ComputeCrc32c(&key.channel, sizeof(key.channel));
+	hash          = ComputeCrc32c(&key.type, sizeof(key.type), hash);
+	hash          = ComputeCrc32c(&key.color, sizeof(key.color), hash);
+	return ComputeCrc32c(&cmd.line, GetContentSize(cmd), hash);
+}
+
+bool DrawCommandStore::HasSameContent(const SlotIndex slot, const uint8_t channel, const DrawCommandPacket &cmd) const
+{
+	const DrawCommandPacket &stored = m_slots[slot].cmd;
+	const size_t             size   = GetContentSize(cmd);
+
+	return m_slots[slot].channel == channel && stored.type == cmd.type &&
+	       memcmp(&stored.color, &cmd.color, sizeof(Color)) == 0 &&
+	       GetContentSize(stored) == size && memcmp(&stored.line, &cmd.line, size) == 0;
+}
+
+/**
+ * \brief Looks up the stored command identical to cmd.
+ * \return Its slot, or INVALID_SLOT if there is none.
+ */
+DrawCommandStore::SlotIndex DrawCommandStore::FindStored(const uint32_t hash, const uint8_t channel, const DrawCommandPacket &cmd) const
+{
+	const SlotIndex stored = FindContent(hash);
+	return stored != INVALID_SLOT && HasSameContent(stored, channel, cmd) ? stored : INVALID_SLOT;
+}
+
+/**
+ * \brief Looks up the slot indexed under a content hash.
+ * \return The slot, or INVALID_SLOT if no command is indexed under the hash.
+ */
+DrawCommandStore::SlotIndex DrawCommandStore::FindContent(const uint32_t hash) const
+{
+	for (size_t i = hash & m_contentMask; m_contentIndex[i].slot != INVALID_SLOT; i = (i + 1) & m_contentMask)
+	{
+		if (m_contentIndex[i].hash == hash)
+			return m_contentIndex[i].slot;
+	}
+	return INVALID_SLOT;
+}
+
+/**
+ * \brief Indexes a slot under a content hash, replacing the slot indexed under it before if any.
+ */
+void DrawCommandStore::SetContent(const uint32_t hash, const SlotIndex slot)
+{
+	size_t i = hash & m_contentMask;
+	while (m_contentIndex[i].slot != INVALID_SLOT && m_contentIndex[i].hash != hash)
+	{
+		i = (i + 1) & m_contentMask;
+	}
+	m_contentIndex[i] = {hash, slot};
+}
+
+/**
+ * \brief Removes a content hash from the index if the given slot is the one indexed under it.
+ * The entries after it are shifted back into the hole where that shortens their probe sequence,
+ * so the table never fills up with tombstones.
+ */
+void DrawCommandStore::EraseContent(const uint32_t hash, const SlotIndex slot)
+{
+	size_t hole = hash & m_contentMask;
+	while (m_contentIndex[hole].slot != INVALID_SLOT && m_contentIndex[hole].hash != hash)
+	{
+		hole = (hole + 1) & m_contentMask;
+	}
+	if (m_contentIndex[hole].slot != slot)
+		return;
+
+	for (size_t next = (hole + 1) & m_contentMask; m_contentIndex[next].slot != INVALID_SLOT; next = (next + 1) & m_contentMask)
+	{
+		// An entry can fill the hole if the hole lies between its home and where it is now.
+		const size_t home = m_contentIndex[next].hash & m_contentMask;
+		if (((next - home) & m_contentMask) >= ((next - hole) & m_contentMask))
+		{
+			m_contentIndex[hole] = m_contentIndex[next];
+			hole                 = next;
+		}
+	}
+	m_contentIndex[hole].slot = INVALID_SLOT;
+}
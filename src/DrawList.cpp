@@ -0,0 +1,198 @@
+#include "DrawList.h"
+
+#include <iostream>
+
+namespace
+{
+	template <typename TPosition>
+	void AddText(DrawList::Texts<TPosition> &texts, const TPosition &position, const StringPool::StringId textId, const Color &color)
+	{
+		texts.positions.push_back(position);
+		texts.stringIds.push_back(textId);
+		texts.colors.push_back(color);
+	}
+
+	template <typename TPosition>
+	void ClearTexts(DrawList::Texts<TPosition> &texts)
+	{
+		texts.positions.clear();
+		texts.stringIds.clear();
+		texts.colors.clear();
+	}
+}
+
+std::optional<PrimitiveRef> DrawList::Add(const DrawCommandPacket &cmd, const StringPool::StringId textId)
+{
+	switch (cmd.type)
+	{
+		case DrawCommandType::LINE:
+		{
+			lines.points.push_back(cmd.line.start.ToRayLib());
+			lines.points.push_back(cmd.line.end.ToRayLib());
+			lines.colors.push_back(cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(lines.GetCount() - 1)};
+		}
+		case DrawCommandType::TRIANGLE:
+		{
+			triangles.points.push_back(cmd.triangle.p1.ToRayLib());
+			triangles.points.push_back(cmd.triangle.p2.ToRayLib());
+			triangles.points.push_back(cmd.triangle.p3.ToRayLib());
+			triangles.colors.push_back(cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(triangles.GetCount() - 1)};
+		}
+		case DrawCommandType::SPHERE:
+		{
+			spheres.centers.push_back(cmd.sphere.center.ToRayLib());
+			spheres.radii.push_back(cmd.sphere.radius);
+			spheres.colors.push_back(cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(spheres.GetCount() - 1)};
+		}
+		case DrawCommandType::CIRCLE:
+		{
+			circles.centers.push_back(cmd.circle.center.ToRayLib());
+			circles.radii.push_back(cmd.circle.radius);
+			circles.rotationAxes.push_back(cmd.circle.xAxis.ToRayLib());
+			circles.rotationAngles.push_back(cmd.circle.yAxis.ToRayLib().y);
+			circles.colors.push_back(cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(circles.GetCount() - 1)};
+		}
+		case DrawCommandType::BBOX:
+		{
+			boxes.mins.push_back(cmd.box.mins.ToRayLib());
+			boxes.maxs.push_back(cmd.box.maxs.ToRayLib());
+			boxes.colors.push_back(cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(boxes.GetCount() - 1)};
+		}
+		case DrawCommandType::TEXT:
+		{
+			if (textId == StringPool::INVALID_ID)
+				return std::nullopt;
+
+			if (cmd.text.onscreen)
+			{
+				AddText(screenTexts, {cmd.text.position.x, cmd.text.position.y}, textId, cmd.color);
+				return PrimitiveRef{cmd.type, static_cast<uint32_t>(screenTexts.GetCount() - 1)};
+			}
+			AddText(worldTexts, cmd.text.position.ToRayLib(), textId, cmd.color);
+			return PrimitiveRef{cmd.type, static_cast<uint32_t>(worldTexts.GetCount() - 1)};
+		}
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+		{
+			std::cout << "Unknown cmd type : " << static_cast<int>(cmd.type) << '\n';
+			return std::nullopt;
+		}
+	}
+}
+
+void DrawList::Set(const PrimitiveRef &primitive, const DrawCommandPacket &cmd)
+{
+	const size_t i = primitive.index;
+	switch (cmd.type)
+	{
+		case DrawCommandType::LINE:
+		{
+			lines.points[i * 2]     = cmd.line.start.ToRayLib();
+			lines.points[i * 2 + 1] = cmd.line.end.ToRayLib();
+			lines.colors[i]         = cmd.color;
+			break;
+		}
+		case DrawCommandType::TRIANGLE:
+		{
+			triangles.points[i * 3]     = cmd.triangle.p1.ToRayLib();
+			triangles.points[i * 3 + 1] = cmd.triangle.p2.ToRayLib();
+			triangles.points[i * 3 + 2] = cmd.triangle.p3.ToRayLib();
+			triangles.colors[i]         = cmd.color;
+			break;
+		}
+		case DrawCommandType::SPHERE:
+		{
+			spheres.centers[i] = cmd.sphere.center.ToRayLib();
+			spheres.radii[i]   = cmd.sphere.radius;
+			spheres.colors[i]  = cmd.color;
+			break;
+		}
+		case DrawCommandType::CIRCLE:
+		{
+			circles.centers[i]        = cmd.circle.center.ToRayLib();
+			circles.radii[i]          = cmd.circle.radius;
+			circles.rotationAxes[i]   = cmd.circle.xAxis.ToRayLib();
+			circles.rotationAngles[i] = cmd.circle.yAxis.ToRayLib().y;
+			circles.colors[i]         = cmd.color;
+			break;
+		}
+		case DrawCommandType::BBOX:
+		{
+			boxes.mins[i]   = cmd.box.mins.ToRayLib();
+			boxes.maxs[i]   = cmd.box.maxs.ToRayLib();
+			boxes.colors[i] = cmd.color;
+			break;
+		}
+		case DrawCommandType::TEXT:
+		{
+			if (cmd.text.onscreen)
+			{
+				screenTexts.positions[i] = {cmd.text.position.x, cmd.text.position.y};
+				screenTexts.colors[i]    = cmd.color;
+			}
+			else
+			{
+				worldTexts.positions[i] = cmd.text.position.ToRayLib();
+				worldTexts.colors[i]    = cmd.color;
+			}
+			break;
+		}
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			break;
+	}
+}
+
+size_t DrawList::GetCount(const DrawCommandType type) const
+{
+	switch (type)
+	{
+		case DrawCommandType::LINE:
+			return lines.GetCount();
+		case DrawCommandType::TRIANGLE:
+			return triangles.GetCount();
+		case DrawCommandType::SPHERE:
+			return spheres.GetCount();
+		case DrawCommandType::CIRCLE:
+			return circles.GetCount();
+		case DrawCommandType::BBOX:
+			return boxes.GetCount();
+		case DrawCommandType::TEXT:
+			return worldTexts.GetCount() + screenTexts.GetCount();
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			return 0;
+	}
+}
+
+void DrawList::Clear()
+{
+	lines.points.clear();
+	lines.colors.clear();
+
+	triangles.points.clear();
+	triangles.colors.clear();
+
+	spheres.centers.clear();
+	spheres.radii.clear();
+	spheres.colors.clear();
+
+	circles.centers.clear();
+	circles.radii.clear();
+	circles.rotationAxes.clear();
+	circles.rotationAngles.clear();
+	circles.colors.clear();
+
+	boxes.mins.clear();
+	boxes.maxs.clear();
+	boxes.colors.clear();
+
+	ClearTexts(worldTexts);
+	ClearTexts(screenTexts);
+
+	hierarchy.reset();
+	patchedFrom = 0;
+	patched.clear();
+}
@@ -0,0 +1,238 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BoundingVolumeHierarchy.h"
+#include "Raylib/raymath.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLER_HAS_SSE_PATH
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	size_t TypeIndex(const DrawCommandType type)
+	{
+		return static_cast<size_t>(type);
+	}
+
+	Vector3 Midpoint(const Vector3 &a, const Vector3 &b)
+	{
+		return Vector3Scale(Vector3Add(a, b), 0.5f);
+	}
+
+	bool IsSameFrustum(const Frustum &a, const Frustum &b)
+	{
+		return memcmp(a.planes.data(), b.planes.data(), sizeof(a.planes)) == 0;
+	}
+}
+
+void BoundingSpheres::Add(const Vector3 &center, const float radius)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radii.push_back(radius);
+}
+
+void BoundingSpheres::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radii.clear();
+}
+
+void Frustum::CullSpheres(const BoundingSpheres &spheres, std::vector<uint32_t> &visible) const
+{
+	const size_t count = spheres.GetCount();
+	size_t       first = 0;
+
+#if defined(FRUSTUM_CULLER_HAS_SSE_PATH)
+	// Four spheres against all six planes per step.
+	first = count & ~static_cast<size_t>(3);
+	for (size_t i = 0; i < first; i += 4)
+	{
+		const __m128 x         = _mm_loadu_ps(spheres.centerX.data() + i);
+		const __m128 y         = _mm_loadu_ps(spheres.centerY.data() + i);
+		const __m128 z         = _mm_loadu_ps(spheres.centerZ.data() + i);
+		const __m128 minusR    = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radii.data() + i));
+		__m128       isVisible = _mm_cmpeq_ps(x, x); // All set, unless the center is NaN
+
+		for (const Vector4 &plane : planes)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+			                                   _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			isVisible = _mm_and_ps(isVisible, _mm_cmpge_ps(distance, minusR));
+		}
+
+		for (int mask = _mm_movemask_ps(isVisible), lane = 0; mask != 0; lane++, mask >>= 1)
+		{
+			if (mask & 1)
+				visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+#endif
+
+	for (size_t i = first; i < count; i++)
+	{
+		bool isVisible = true;
+		for (const Vector4 &plane : planes)
+		{
+			// Summed in the same order as the SSE path.
+			const float distance = (spheres.centerX[i] * plane.x + spheres.centerY[i] * plane.y) + (spheres.centerZ[i] * plane.z + plane.w);
+			isVisible            = isVisible && distance >= -spheres.radii[i];
+		}
+		if (isVisible)
+			visible.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+std::span<const Visibility> FrustumCuller::Cull(const std::span<const DrawList *const> lists, const Frustum &frustum)
+{
+	m_entries.resize(lists.size());
+	m_visibilities.resize(lists.size());
+	m_stats = {};
+
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		Entry &entry = m_entries[i];
+
+		if (entry.sourceVersion != lists[i]->version)
+		{
+			// The hierarchy replaces the bounds of a list that has one.
+			if (!lists[i]->hierarchy)
+				ComputeBounds(*lists[i], entry.bounds);
+			entry.sourceVersion = lists[i]->version;
+			entry.culled        = false;
+		}
+
+		if (!entry.culled || !IsSameFrustum(entry.frustum, frustum))
+		{
+			CullEntry(entry, m_visibilities[i], *lists[i], frustum);
+		}
+
+		for (size_t type = 0; type < m_stats.visible.size(); type++)
+		{
+			m_stats.visible[type] += entry.stats.visible[type];
+			m_stats.culled[type] += entry.stats.culled[type];
+		}
+	}
+
+	return m_visibilities;
+}
+
+/**
+ * \brief Computes the bounding sphere of every line, triangle, sphere, circle and box of a list.
+ */
+void FrustumCuller::ComputeBounds(const DrawList &list, TypeBounds &bounds)
+{
+	for (BoundingSpheres &typeBounds : bounds)
+	{
+		typeBounds.Clear();
+	}
+
+	BoundingSpheres &lines = bounds[TypeIndex(DrawCommandType::LINE)];
+	for (size_t i = 0; i < list.lines.GetCount(); i++)
+	{
+		const Vector3 &start = list.lines.points[i * 2];
+		const Vector3 &end   = list.lines.points[i * 2 + 1];
+		lines.Add(Midpoint(start, end), Vector3Distance(start, end) * 0.5f);
+	}
+
+	BoundingSpheres &triangles = bounds[TypeIndex(DrawCommandType::TRIANGLE)];
+	for (size_t i = 0; i < list.triangles.GetCount(); i++)
+	{
+		const Vector3 *corners  = &list.triangles.points[i * 3];
+		const Vector3  centroid = Vector3Scale(Vector3Add(Vector3Add(corners[0], corners[1]), corners[2]), 1.0f / 3.0f);
+		const float    radius   = fmaxf(Vector3Distance(centroid, corners[0]),
+		                                fmaxf(Vector3Distance(centroid, corners[1]), Vector3Distance(centroid, corners[2])));
+		triangles.Add(centroid, radius);
+	}
+
+	BoundingSpheres &spheres = bounds[TypeIndex(DrawCommandType::SPHERE)];
+	for (size_t i = 0; i < list.spheres.GetCount(); i++)
+	{
+		spheres.Add(list.spheres.centers[i], list.spheres.radii[i]);
+	}
+
+	// Whatever the orientation of a circle, its sphere holds it.
+	BoundingSpheres &circles = bounds[TypeIndex(DrawCommandType::CIRCLE)];
+	for (size_t i = 0; i < list.circles.GetCount(); i++)
+	{
+		circles.Add(list.circles.centers[i], list.circles.radii[i]);
+	}
+
+	BoundingSpheres &boxes = bounds[TypeIndex(DrawCommandType::BBOX)];
+	for (size_t i = 0; i < list.boxes.GetCount(); i++)
+	{
+		boxes.Add(Midpoint(list.boxes.mins[i], list.boxes.maxs[i]), Vector3Distance(list.boxes.mins[i], list.boxes.maxs[i]) * 0.5f);
+	}
+}
+
+/**
+ * \brief Recomputes which primitives of the list of an entry touch the frustum.
+ * The visibility keeps its version if the visible primitives are the same as before.
+ */
+void FrustumCuller::CullEntry(Entry &entry, Visibility &visibility, const DrawList &list, const Frustum &frustum)
+{
+	if (list.hierarchy)
+	{
+		QueryHierarchy(*list.hierarchy, frustum);
+	}
+
+	for (size_t type = 0; type < m_visibleIndices.size(); type++)
+	{
+		std::vector<uint32_t> &indices = m_visibleIndices[type];
+		if (!list.hierarchy)
+		{
+			indices.clear();
+			frustum.CullSpheres(entry.bounds[type], indices);
+		}
+
+		entry.stats.visible[type] = indices.size();
+		entry.stats.culled[type]  = list.GetCount(static_cast<DrawCommandType>(type)) - indices.size();
+	}
+
+	// A camera that moved a little usually still sees the same primitives.
+	if (visibility.indices != m_visibleIndices)
+	{
+		std::swap(visibility.indices, m_visibleIndices);
+		visibility.version = m_nextVersion++;
+	}
+
+	entry.frustum = frustum;
+	entry.culled  = true;
+}
+
+/**
+ * \brief Fills m_visibleIndices with the primitives of the hierarchy's list whose leaves touch the frustum.
+ */
+void FrustumCuller::QueryHierarchy(const PrimitiveHierarchy &hierarchy, const Frustum &frustum)
+{
+	for (std::vector<uint32_t> &indices : m_visibleIndices)
+	{
+		indices.clear();
+	}
+
+	m_visibleLeaves.clear();
+	hierarchy.tree.QueryFrustum(frustum, m_visibleLeaves);
+
+	const std::vector<std::optional<PrimitiveRef>> &primitives = *hierarchy.primitives;
+	for (const uint32_t payload : m_visibleLeaves)
+	{
+		if (const std::optional<PrimitiveRef> &primitive = primitives[payload])
+		{
+			m_visibleIndices[TypeIndex(primitive->type)].push_back(primitive->index);
+		}
+	}
+
+	// The leaves come in tree order, keep the primitives in list order.
+	for (std::vector<uint32_t> &indices : m_visibleIndices)
+	{
+		std::ranges::sort(indices);
+	}
+}
@@ -0,0 +1,214 @@
+#include "IngestWaitStrategy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	void CpuRelax()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#endif
+	}
+}
+
+void LatencyHistogram::Record(const std::chrono::nanoseconds duration)
+{
+	const auto microseconds = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+
+	// Bucket 0 is <1us, bucket N covers [2^(N-1), 2^N) us, the last one everything above.
+	const size_t bucket = std::min<size_t>(std::bit_width(microseconds), BUCKET_COUNT - 1);
+
+	m_buckets[bucket]++;
+	m_count++;
+}
+
+void LatencyHistogram::Print(std::ostream &out, const char *name) const
+{
+	out << name << ": " << m_count << " wakes\n";
+
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		if (m_buckets[i] == 0)
+			continue;
+
+		const uint64_t low = i == 0 ? 0 : static_cast<uint64_t>(1) << (i - 1);
+		if (i == BUCKET_COUNT - 1)
+			out << "  >= " << low << "us: " << m_buckets[i] << '\n';
+		else
+			out << "  [" << low << ", " << (static_cast<uint64_t>(1) << i) << ")us: " << m_buckets[i] << '\n';
+	}
+}
+
+IngestWaitStrategy::IngestWaitStrategy(const Config::IngestWaitMode mode) : m_mode(mode) { }
+
+bool IngestWaitStrategy::Wait(SharedMemoryTransport &transport, SharedMemoryLayout &layout, const size_t tail)
+{
+	std::atomic_ref<size_t> head(layout.head);
+	const auto              hasData = [&]{ return head.load(std::memory_order_acquire) != tail; };
+
+	CountSignals(layout);
+
+	// The server may have published more while we were draining, no need to wait at all.
+	if (hasData())
+	{
+		m_signalsElided.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	const auto waitStart = Clock::now();
+
+	if (m_mode == Config::IngestWaitMode::BLOCK)
+	{
+		return Block(transport, layout, tail, Config::INGEST_BLOCK_TIMEOUT_MS) && OnData(Phase::BLOCK, waitStart);
+	}
+
+	constexpr auto spinBudget = std::chrono::microseconds(Config::INGEST_SPIN_BUDGET_US);
+	constexpr auto pollBudget = spinBudget + std::chrono::microseconds(Config::INGEST_YIELD_BUDGET_US);
+
+	// Block through the quiet part of the tick and only start polling shortly before the next one is due.
+	// If the signal arrives early we still wake up right away.
+	std::chrono::nanoseconds pollFor = pollBudget;
+	if (m_mode == Config::IngestWaitMode::ADAPTIVE && m_tickInterval > std::chrono::nanoseconds::zero())
+	{
+		const auto untilDue = m_lastDataTime + m_tickInterval - waitStart;
+		const auto sleepFor = std::chrono::duration_cast<std::chrono::milliseconds>(untilDue - pollBudget).count();
+
+		if (sleepFor > 0)
+		{
+			if (Block(transport, layout, tail, static_cast<uint32_t>(std::min<int64_t>(sleepFor, Config::INGEST_BLOCK_TIMEOUT_MS))))
+				return OnData(Phase::SLEEP, waitStart);
+		}
+
+		// The block only counts whole milliseconds, so it ends up to one early. Polling just the budget from there
+		// would block again before the tick, and the server would signal after all: poll past the due time instead.
+		const auto dueIn = m_lastDataTime + m_tickInterval - Clock::now();
+		pollFor          = std::clamp<std::chrono::nanoseconds>(dueIn, std::chrono::nanoseconds::zero(), std::chrono::milliseconds(1)) + pollBudget;
+	}
+
+	const auto pollStart = Clock::now();
+
+	while (Clock::now() - pollStart < spinBudget)
+	{
+		if (hasData())
+			return OnData(Phase::SPIN, waitStart);
+
+		CpuRelax();
+	}
+
+	while (Clock::now() - pollStart < pollFor)
+	{
+		if (hasData())
+			return OnData(Phase::YIELD, waitStart);
+
+		std::this_thread::yield();
+	}
+
+	return Block(transport, layout, tail, Config::INGEST_BLOCK_TIMEOUT_MS) && OnData(Phase::BLOCK, waitStart);
+}
+
+/**
+ * \brief Tells the server we need a signal, then blocks on the transport unless data arrived in the meantime.
+ *        While we are polling the server skips the signal entirely (see ShouldSignalClient).
+ * \return True if there is data to drain.
+ */
+bool IngestWaitStrategy::Block(SharedMemoryTransport &transport, SharedMemoryLayout &layout, const size_t tail, const uint32_t timeoutMs)
+{
+	std::atomic_ref<size_t>          head(layout.head);
+	std::atomic_ref<ClientWakeState> state(layout.clientState);
+
+	state.store(ClientWakeState::NEEDS_SIGNAL, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// Re-check head after announcing we are going to sleep. If the server published before it could
+	// see our state it did not signal, but then we are guaranteed to see its head here.
+	if (head.load(std::memory_order_acquire) == tail)
+	{
+		transport.WaitForData(timeoutMs);
+	}
+
+	state.store(ClientWakeState::POLLING, std::memory_order_relaxed);
+	return head.load(std::memory_order_acquire) != tail;
+}
+
+void IngestWaitStrategy::OnStop(SharedMemoryLayout &layout)
+{
+	// A new connection starts counting from its own signal word.
+	CountSignals(layout);
+	m_signalCounted = false;
+
+	// Whoever connects next starts out needing signals.
+	std::atomic_ref(layout.clientState).store(ClientWakeState::NEEDS_SIGNAL, std::memory_order_relaxed);
+}
+
+bool IngestWaitStrategy::OnData(const Phase phase, const Clock::time_point waitStart)
+{
+	const auto now = Clock::now();
+
+	m_wakeHistograms[static_cast<size_t>(phase)].Record(now - waitStart);
+	if (phase == Phase::SPIN || phase == Phase::YIELD)
+	{
+		m_signalsElided.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Track the interval between ticks with an exponential moving average,
+	// ignoring gaps long enough that the server was probably paused.
+	if (m_lastDataTime != Clock::time_point())
+	{
+		const auto interval = now - m_lastDataTime;
+		if (interval < std::chrono::seconds(1))
+		{
+			if (m_tickInterval == std::chrono::nanoseconds::zero())
+				m_tickInterval = interval;
+			else
+				m_tickInterval += (interval - m_tickInterval) / 8;
+		}
+	}
+
+	m_lastDataTime = now;
+	return true;
+}
+
+/**
+ * \brief Adds the signals the server sent since the last call to the total.
+ *        The server bumps the signal word once per signal, whether or not anyone was waiting on it.
+ */
+void IngestWaitStrategy::CountSignals(SharedMemoryLayout &layout)
+{
+	const uint32_t signal = std::atomic_ref(layout.signal).load(std::memory_order_relaxed);
+	if (m_signalCounted)
+	{
+		m_signalsSent.fetch_add(signal - m_lastSignal, std::memory_order_relaxed);
+	}
+	m_lastSignal    = signal;
+	m_signalCounted = true;
+}
+
+void IngestWaitStrategy::PrintStats(std::ostream &out) const
+{
+	static constexpr const char *phaseNames[] = {"Sleep", "Spin", "Yield", "Block"};
+
+	out << "Client: Time waited before new data, by the phase that found it";
+	if (m_mode == Config::IngestWaitMode::ADAPTIVE)
+	{
+		out << " (tick interval " << std::chrono::duration_cast<std::chrono::microseconds>(m_tickInterval).count() << "us)";
+	}
+	out << '\n';
+
+	for (size_t i = 0; i < m_wakeHistograms.size(); i++)
+	{
+		if (m_wakeHistograms[i].GetCount() > 0)
+		{
+			m_wakeHistograms[i].Print(out, phaseNames[i]);
+		}
+	}
+
+	out << "Client: Server signaled " << GetSignalsSent() << " times, skipped the signal for " << GetSignalsElided() << " polled wakes.\n";
+}
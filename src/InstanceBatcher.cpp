@@ -0,0 +1,556 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "config.h"
+#include "win32_minimal.h"
+#include "Raylib/rlgl.h"
+
+namespace
+{
+	// Attribute locations, fixed in the shader.
+	constexpr unsigned int POSITION_LOCATION = 0;
+	constexpr unsigned int INDEX_LOCATION    = 1;
+
+	// Texture slots the instance data is bound to while drawing. rlgl only uses the first one.
+	constexpr int TRANSFORM_TEXTURE_SLOT = 1;
+	constexpr int COLOR_TEXTURE_SLOT     = 2;
+
+	// GL enums rlgl has no name for.
+	constexpr unsigned int GL_TEXTURE_BUFFER_TARGET = 0x8C2A; // GL_TEXTURE_BUFFER
+	constexpr unsigned int GL_RGBA32F_FORMAT        = 0x8814; // GL_RGBA32F
+	constexpr unsigned int GL_RGBA8_FORMAT          = 0x8058; // GL_RGBA8
+
+	// The index is a float attribute, which holds any instance index a buffer can fit exactly.
+	constexpr auto INSTANCE_VERTEX_SHADER = R"(#version 330
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in float instanceIndex;
+uniform mat4 mvp;
+uniform samplerBuffer transforms;
+uniform samplerBuffer colors;
+out vec4 fragColor;
+void main()
+{
+	int instance = int(instanceIndex);
+	mat4 transform = mat4(texelFetch(transforms, instance * 4), texelFetch(transforms, instance * 4 + 1),
+	                      texelFetch(transforms, instance * 4 + 2), texelFetch(transforms, instance * 4 + 3));
+	fragColor = texelFetch(colors, instance);
+	gl_Position = mvp * transform * vec4(vertexPosition, 1.0);
+})";
+
+	constexpr auto INSTANCE_FRAGMENT_SHADER = R"(#version 330
+in vec4 fragColor;
+out vec4 finalColor;
+void main()
+{
+	finalColor = fragColor;
+})";
+
+	constexpr size_t INITIAL_INSTANCE_CAPACITY = 1024;
+
+	// Segments of the unit circle, as DrawCircle3D draws it.
+	constexpr int CIRCLE_SEGMENTS = 36;
+
+	void AddLine(std::vector<Vector3> &vertices, const Vector3 &start, const Vector3 &end)
+	{
+		vertices.push_back(start);
+		vertices.push_back(end);
+	}
+
+	// Radius 1 around the origin, with Config::DEBUG_CYLINDER_SLICES rings and slices like the DrawSphereWires it replaces.
+	std::vector<Vector3> BuildUnitSphere()
+	{
+		constexpr int rings  = Config::DEBUG_CYLINDER_SLICES;
+		constexpr int slices = Config::DEBUG_CYLINDER_SLICES;
+
+		const auto point = [](const int ring, const int slice)
+		{
+			const float latitude  = PI * static_cast<float>(ring) / (rings + 1);
+			const float longitude = 2.0f * PI * static_cast<float>(slice) / slices;
+			return Vector3{sinf(latitude) * cosf(longitude), cosf(latitude), sinf(latitude) * sinf(longitude)};
+		};
+
+		std::vector<Vector3> vertices;
+		for (int slice = 0; slice < slices; slice++)
+		{
+			// Meridian from pole to pole, and the segments of each ring eastwards.
+			for (int ring = 0; ring <= rings; ring++)
+			{
+				AddLine(vertices, point(ring, slice), point(ring + 1, slice));
+			}
+			for (int ring = 1; ring <= rings; ring++)
+			{
+				AddLine(vertices, point(ring, slice), point(ring, slice + 1));
+			}
+		}
+		return vertices;
+	}
+
+	// Radius 1 around the origin in the XY plane.
+	std::vector<Vector3> BuildUnitCircle()
+	{
+		const auto point = [](const int segment)
+		{
+			const float angle = 2.0f * PI * static_cast<float>(segment) / CIRCLE_SEGMENTS;
+			return Vector3{sinf(angle), cosf(angle), 0.0f};
+		};
+
+		std::vector<Vector3> vertices;
+		for (int segment = 0; segment < CIRCLE_SEGMENTS; segment++)
+		{
+			AddLine(vertices, point(segment), point(segment + 1));
+		}
+		return vertices;
+	}
+
+	// The edges of the cube from (0, 0, 0) to (1, 1, 1).
+	std::vector<Vector3> BuildUnitBox()
+	{
+		std::vector<Vector3> vertices;
+		for (int a = 0; a < 2; a++)
+		{
+			for (int b = 0; b < 2; b++)
+			{
+				const auto fa = static_cast<float>(a);
+				const auto fb = static_cast<float>(b);
+				AddLine(vertices, {0, fa, fb}, {1, fa, fb});
+				AddLine(vertices, {fa, 0, fb}, {fa, 1, fb});
+				AddLine(vertices, {fa, fb, 0}, {fa, fb, 1});
+			}
+		}
+		return vertices;
+	}
+
+	// Scale, then translate, in the column-major order the shader takes.
+	float16 MakeTransform(const Vector3 &scale, const Vector3 &translation)
+	{
+		return {{
+			scale.x, 0.0f, 0.0f, 0.0f,
+			0.0f, scale.y, 0.0f, 0.0f,
+			0.0f, 0.0f, scale.z, 0.0f,
+			translation.x, translation.y, translation.z, 1.0f,
+		}};
+	}
+}
+
+InstanceBatcher::InstanceBatcher()
+{
+	m_drawArraysInstanced = reinterpret_cast<DrawArraysInstanced>(wglGetProcAddress("glDrawArraysInstanced"));
+	if (!m_drawArraysInstanced)
+	{
+		std::cerr << "Failed to load glDrawArraysInstanced" << '\n';
+		return;
+	}
+
+	m_texBuffer = reinterpret_cast<TexBuffer>(wglGetProcAddress("glTexBuffer"));
+	if (!m_texBuffer)
+	{
+		std::cerr << "Failed to load glTexBuffer" << '\n';
+		return;
+	}
+
+	m_shader = rlLoadShaderCode(INSTANCE_VERTEX_SHADER, INSTANCE_FRAGMENT_SHADER);
+	if (m_shader == 0)
+	{
+		std::cerr << "Failed to load instance shader" << '\n';
+		return;
+	}
+	m_mvpLocation        = rlGetLocationUniform(m_shader, "mvp");
+	m_transformsLocation = rlGetLocationUniform(m_shader, "transforms");
+	m_colorsLocation     = rlGetLocationUniform(m_shader, "colors");
+
+	if (!LoadShape(m_shapes[SPHERE], BuildUnitSphere()) ||
+	    !LoadShape(m_shapes[CIRCLE], BuildUnitCircle()) ||
+	    !LoadShape(m_shapes[BOX], BuildUnitBox()))
+	{
+		std::cerr << "Failed to create instance meshes" << '\n';
+	}
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+	for (const Shape &shape : m_shapes)
+	{
+		for (const unsigned int buffer : {shape.meshBuffer, shape.transformBuffer, shape.colorBuffer, shape.indexBuffer})
+		{
+			if (buffer != 0)
+				rlUnloadVertexBuffer(buffer);
+		}
+		for (const unsigned int texture : {shape.transformTexture, shape.colorTexture})
+		{
+			if (texture != 0)
+				glDeleteTextures(1, &texture);
+		}
+		if (shape.vertexArray != 0)
+			rlUnloadVertexArray(shape.vertexArray);
+	}
+
+	if (m_shader != 0)
+		rlUnloadShaderProgram(m_shader);
+}
+
+bool InstanceBatcher::IsValid() const
+{
+	return m_drawArraysInstanced && m_texBuffer && m_shader != 0 &&
+	       std::ranges::all_of(m_shapes, [](const Shape &shape){ return shape.vertexArray != 0; });
+}
+
+void InstanceBatcher::Update(const std::span<const DrawList *const> lists, const std::span<const Visibility> visibility)
+{
+	if (!IsValid())
+		return;
+
+	for (const ShapeType type : {SPHERE, CIRCLE, BOX})
+	{
+		UpdateShape(type, lists);
+		UpdateIndices(type, visibility);
+	}
+}
+
+void InstanceBatcher::Draw() const
+{
+	if (!IsValid())
+		return;
+
+	// Draw whatever rlgl batched so far first, so the instances keep their place in the draw order.
+	rlDrawRenderBatchActive();
+
+	rlEnableShader(m_shader);
+	rlSetUniformMatrix(m_mvpLocation, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+	rlSetUniform(m_transformsLocation, &TRANSFORM_TEXTURE_SLOT, RL_SHADER_UNIFORM_INT, 1);
+	rlSetUniform(m_colorsLocation, &COLOR_TEXTURE_SLOT, RL_SHADER_UNIFORM_INT, 1);
+
+	for (const Shape &shape : m_shapes)
+	{
+		if (shape.drawCount == 0)
+			continue;
+
+		rlActiveTextureSlot(TRANSFORM_TEXTURE_SLOT);
+		glBindTexture(GL_TEXTURE_BUFFER_TARGET, shape.transformTexture);
+		rlActiveTextureSlot(COLOR_TEXTURE_SLOT);
+		glBindTexture(GL_TEXTURE_BUFFER_TARGET, shape.colorTexture);
+
+		rlEnableVertexArray(shape.vertexArray);
+		m_drawArraysInstanced(RL_LINES, 0, shape.vertexCount, static_cast<int>(shape.drawCount));
+	}
+	rlDisableVertexArray();
+
+	// Leave the texture slots the way rlgl expects them.
+	for (const int slot : {TRANSFORM_TEXTURE_SLOT, COLOR_TEXTURE_SLOT})
+	{
+		rlActiveTextureSlot(slot);
+		glBindTexture(GL_TEXTURE_BUFFER_TARGET, 0);
+	}
+	rlActiveTextureSlot(0);
+
+	rlDisableShader();
+}
+
+/**
+ * \brief Uploads a unit mesh and sets up the vertex array drawing instances of it.
+ * \param shape The shape to load, its buffers must not exist yet.
+ * \param lineVertices Start and end of each line of the mesh.
+ * \return Whether the vertex array could be created.
+ */
+bool InstanceBatcher::LoadShape(Shape &shape, const std::vector<Vector3> &lineVertices)
+{
+	shape.vertexArray = rlLoadVertexArray();
+	if (shape.vertexArray == 0)
+		return false;
+
+	rlEnableVertexArray(shape.vertexArray);
+	shape.meshBuffer  = rlLoadVertexBuffer(lineVertices.data(), static_cast<int>(lineVertices.size() * sizeof(Vector3)), false);
+	shape.vertexCount = static_cast<int>(lineVertices.size());
+	rlSetVertexAttribute(POSITION_LOCATION, 3, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(POSITION_LOCATION);
+	rlDisableVertexArray();
+
+	glGenTextures(1, &shape.transformTexture);
+	glGenTextures(1, &shape.colorTexture);
+	if (shape.transformTexture == 0 || shape.colorTexture == 0)
+		return false;
+
+	Reserve(shape, INITIAL_INSTANCE_CAPACITY);
+	ReserveIndices(shape, INITIAL_INSTANCE_CAPACITY);
+	return true;
+}
+
+/**
+ * \brief Replaces the instance buffers of a shape with empty ones that hold the given number of instances.
+ * \param shape The shape whose instance buffers to replace.
+ * \param instanceCount The number of instances the new buffers must hold.
+ */
+void InstanceBatcher::Reserve(Shape &shape, const size_t instanceCount)
+{
+	if (shape.transformBuffer != 0)
+		rlUnloadVertexBuffer(shape.transformBuffer);
+	if (shape.colorBuffer != 0)
+		rlUnloadVertexBuffer(shape.colorBuffer);
+
+	// Not attributes: the shader fetches them through the textures, by instance index.
+	shape.transformBuffer = rlLoadVertexBuffer(nullptr, static_cast<int>(instanceCount * sizeof(float16)), true);
+	shape.colorBuffer     = rlLoadVertexBuffer(nullptr, static_cast<int>(instanceCount * sizeof(Color)), true);
+
+	glBindTexture(GL_TEXTURE_BUFFER_TARGET, shape.transformTexture);
+	m_texBuffer(GL_TEXTURE_BUFFER_TARGET, GL_RGBA32F_FORMAT, shape.transformBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER_TARGET, shape.colorTexture);
+	m_texBuffer(GL_TEXTURE_BUFFER_TARGET, GL_RGBA8_FORMAT, shape.colorBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER_TARGET, 0);
+
+	shape.capacity = instanceCount;
+}
+
+/**
+ * \brief Replaces the index buffer of a shape with an empty one that holds the given number of indices.
+ * \param shape The shape whose index buffer to replace.
+ * \param indexCount The number of indices the new buffer must hold.
+ */
+void InstanceBatcher::ReserveIndices(Shape &shape, const size_t indexCount)
+{
+	if (shape.indexBuffer != 0)
+		rlUnloadVertexBuffer(shape.indexBuffer);
+
+	rlEnableVertexArray(shape.vertexArray);
+	shape.indexBuffer = rlLoadVertexBuffer(nullptr, static_cast<int>(indexCount * sizeof(float)), true);
+	rlSetVertexAttribute(INDEX_LOCATION, 1, RL_FLOAT, false, 0, 0);
+	rlSetVertexAttributeDivisor(INDEX_LOCATION, 1);
+	rlEnableVertexAttribute(INDEX_LOCATION);
+	rlDisableVertexArray();
+
+	shape.indexCapacity = indexCount;
+}
+
+void InstanceBatcher::UpdateShape(const ShapeType type, const std::span<const DrawList *const> lists)
+{
+	Shape &shape = m_shapes[type];
+
+	size_t total = 0;
+	for (const DrawList *list : lists)
+	{
+		total += GetInstanceCount(type, *list);
+	}
+
+	if (total > shape.capacity)
+	{
+		// The new buffers are empty, everything has to be uploaded again.
+		Reserve(shape, std::max(total, shape.capacity * 2));
+		shape.uploaded.clear();
+	}
+	shape.uploaded.resize(lists.size());
+
+	size_t firstInstance = 0;
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		const size_t  instanceCount = GetInstanceCount(type, *lists[i]);
+		UploadedList &uploaded      = shape.uploaded[i];
+
+		const bool moved = uploaded.firstInstance != firstInstance || uploaded.instanceCount != instanceCount;
+		if (!moved && uploaded.version != lists[i]->version && uploaded.version == lists[i]->patchedFrom)
+		{
+			const DrawCommandType commandType = GetCommandType(type);
+			for (const PrimitiveRef &primitive : lists[i]->patched)
+			{
+				if (primitive.type == commandType)
+					UploadInstances(type, *lists[i], primitive.index, 1, firstInstance);
+			}
+			uploaded.version = lists[i]->version;
+		}
+		else if (uploaded.version != lists[i]->version || moved)
+		{
+			UploadInstances(type, *lists[i], 0, instanceCount, firstInstance);
+
+			uploaded = {
+				.version = lists[i]->version,
+				.firstInstance = firstInstance,
+				.instanceCount = instanceCount,
+			};
+		}
+
+		firstInstance += instanceCount;
+	}
+
+	shape.instanceCount = firstInstance;
+}
+
+/**
+ * \brief Uploads some of the instances of a shape in a list.
+ * \param type The shape.
+ * \param list The list the instances are in.
+ * \param first The first instance of the shape in the list to upload.
+ * \param count The number of instances to upload.
+ * \param firstInstance Where the instances of the list start in the buffers.
+ */
+void InstanceBatcher::UploadInstances(const ShapeType type, const DrawList &list, const size_t first, const size_t count, const size_t firstInstance)
+{
+	if (count == 0)
+		return;
+
+	const Shape &shape  = m_shapes[type];
+	const size_t offset = firstInstance + first;
+
+	m_transforms.clear();
+	AddTransforms(type, list, first, count, m_transforms);
+	rlUpdateVertexBuffer(shape.transformBuffer, m_transforms.data(), static_cast<int>(count * sizeof(float16)),
+	                     static_cast<int>(offset * sizeof(float16)));
+
+	// Colors are already one per instance and go up as is.
+	rlUpdateVertexBuffer(shape.colorBuffer, GetColors(type, list).data() + first, static_cast<int>(count * sizeof(Color)),
+	                     static_cast<int>(offset * sizeof(Color)));
+}
+
+/**
+ * \brief Rebuilds the index buffer of a shape if the instances to draw changed.
+ * \param type The shape, whose instances were just uploaded.
+ * \param visibility The visibility of each list of the upload, or empty to draw every instance.
+ */
+void InstanceBatcher::UpdateIndices(const ShapeType type, const std::span<const Visibility> visibility)
+{
+	Shape &shape = m_shapes[type];
+
+	m_indices.clear();
+	if (visibility.empty())
+	{
+		// Every instance in order, which only changes with their count.
+		if (!shape.culled && shape.drawCount == shape.instanceCount)
+			return;
+
+		for (size_t i = 0; i < shape.instanceCount; i++)
+		{
+			m_indices.push_back(static_cast<float>(i));
+		}
+		shape.indexed.clear();
+	}
+	else
+	{
+		bool changed = !shape.culled || shape.indexed.size() != visibility.size();
+		shape.indexed.resize(visibility.size());
+		for (size_t i = 0; i < visibility.size(); i++)
+		{
+			IndexedList &indexed = shape.indexed[i];
+			if (indexed.version != visibility[i].version || indexed.firstInstance != shape.uploaded[i].firstInstance)
+			{
+				indexed = {
+					.version = visibility[i].version,
+					.firstInstance = shape.uploaded[i].firstInstance,
+				};
+				changed = true;
+			}
+		}
+
+		if (!changed)
+			return;
+
+		const DrawCommandType commandType = GetCommandType(type);
+		for (size_t i = 0; i < visibility.size(); i++)
+		{
+			for (const uint32_t index : visibility[i].Get(commandType))
+			{
+				m_indices.push_back(static_cast<float>(shape.indexed[i].firstInstance + index));
+			}
+		}
+	}
+	shape.culled = !visibility.empty();
+
+	if (m_indices.size() > shape.indexCapacity)
+	{
+		ReserveIndices(shape, std::max(m_indices.size(), shape.indexCapacity * 2));
+	}
+
+	shape.drawCount = m_indices.size();
+	if (shape.drawCount > 0)
+	{
+		rlUpdateVertexBuffer(shape.indexBuffer, m_indices.data(), static_cast<int>(shape.drawCount * sizeof(float)), 0);
+	}
+}
+
+size_t InstanceBatcher::GetInstanceCount(const ShapeType type, const DrawList &list)
+{
+	switch (type)
+	{
+		case SPHERE:
+			return list.spheres.GetCount();
+		case CIRCLE:
+			return list.circles.GetCount();
+		case BOX:
+			return list.boxes.GetCount();
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			return 0;
+	}
+}
+
+DrawCommandType InstanceBatcher::GetCommandType(const ShapeType type)
+{
+	switch (type)
+	{
+		case SPHERE:
+			return DrawCommandType::SPHERE;
+		case CIRCLE:
+			return DrawCommandType::CIRCLE;
+		case BOX:
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			return DrawCommandType::BBOX;
+	}
+}
+
+const std::vector<Color> &InstanceBatcher::GetColors(const ShapeType type, const DrawList &list)
+{
+	switch (type)
+	{
+		case SPHERE:
+			return list.spheres.colors;
+		case CIRCLE:
+			return list.circles.colors;
+		case BOX:
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			return list.boxes.colors;
+	}
+}
+
+/**
+ * \brief Appends the transforms of a range of instances of a shape in a list, mapping the unit mesh onto the primitive.
+ */
+void InstanceBatcher::AddTransforms(const ShapeType type, const DrawList &list, const size_t first, const size_t count,
+                                    std::vector<float16> &transforms)
+{
+	switch (type)
+	{
+		case SPHERE:
+		{
+			const auto &spheres = list.spheres;
+			for (size_t i = first; i < first + count; i++)
+			{
+				const float radius = spheres.radii[i];
+				transforms.push_back(MakeTransform({radius, radius, radius}, spheres.centers[i]));
+			}
+			break;
+		}
+		case CIRCLE:
+		{
+			// Same as DrawCircle3D: scale, rotate by the angle (in degrees) around the axis, then translate.
+			const auto &circles = list.circles;
+			for (size_t i = first; i < first + count; i++)
+			{
+				const float    radius    = circles.radii[i];
+				const Vector3 &center    = circles.centers[i];
+				const Matrix   transform = MatrixMultiply(MatrixMultiply(MatrixScale(radius, radius, radius),
+				                                                       MatrixRotate(circles.rotationAxes[i], circles.rotationAngles[i] * DEG2RAD)),
+				                                        MatrixTranslate(center.x, center.y, center.z));
+				transforms.push_back(MatrixToFloatV(transform));
+			}
+			break;
+		}
+		case BOX:
+		{
+			const auto &boxes = list.boxes;
+			for (size_t i = first; i < first + count; i++)
+			{
+				transforms.push_back(MakeTransform(Vector3Subtract(boxes.maxs[i], boxes.mins[i]), boxes.mins[i]));
+			}
+			break;
+		}
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			break;
+	}
+}
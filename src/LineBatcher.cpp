@@ -0,0 +1,280 @@
+#include "LineBatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "win32_minimal.h"
+#include "Raylib/raymath.h"
+#include "Raylib/rlgl.h"
+
+namespace
+{
+	constexpr auto LINE_VERTEX_SHADER = R"(#version 330
+in vec3 vertexPosition;
+in vec4 vertexColor;
+uniform mat4 mvp;
+out vec4 fragColor;
+void main()
+{
+	fragColor = vertexColor;
+	gl_Position = mvp * vec4(vertexPosition, 1.0);
+})";
+
+	constexpr auto LINE_FRAGMENT_SHADER = R"(#version 330
+in vec4 fragColor;
+out vec4 finalColor;
+void main()
+{
+	finalColor = fragColor;
+})";
+
+	// Enough for a typical frame, so the buffers rarely have to grow.
+	constexpr size_t INITIAL_VERTEX_CAPACITY = 16 * 1024;
+
+	// GL_UNSIGNED_INT, the type of the indices.
+	constexpr unsigned int INDEX_TYPE = 0x1405;
+}
+
+LineBatcher::LineBatcher()
+{
+	m_shader = rlLoadShaderCode(LINE_VERTEX_SHADER, LINE_FRAGMENT_SHADER);
+	if (m_shader == 0)
+	{
+		std::cerr << "Failed to load line shader" << '\n';
+		return;
+	}
+	m_mvpLocation = rlGetLocationUniform(m_shader, "mvp");
+
+	m_vertexArray = rlLoadVertexArray();
+	if (m_vertexArray == 0)
+	{
+		std::cerr << "Failed to create line vertex array" << '\n';
+		return;
+	}
+
+	Reserve(INITIAL_VERTEX_CAPACITY);
+	ReserveIndices(INITIAL_VERTEX_CAPACITY);
+}
+
+LineBatcher::~LineBatcher()
+{
+	if (m_positionBuffer != 0)
+		rlUnloadVertexBuffer(m_positionBuffer);
+	if (m_colorBuffer != 0)
+		rlUnloadVertexBuffer(m_colorBuffer);
+	if (m_indexBuffer != 0)
+		rlUnloadVertexBuffer(m_indexBuffer);
+	if (m_vertexArray != 0)
+		rlUnloadVertexArray(m_vertexArray);
+	if (m_shader != 0)
+		rlUnloadShaderProgram(m_shader);
+}
+
+void LineBatcher::Update(const std::span<const DrawList *const> lists, const std::span<const Visibility> visibility)
+{
+	if (!IsValid())
+		return;
+
+	size_t total = 0;
+	for (const DrawList *list : lists)
+	{
+		total += list->lines.points.size();
+	}
+
+	if (total > m_capacity)
+	{
+		// The new buffers are empty, everything has to be uploaded again.
+		Reserve(std::max(total, m_capacity * 2));
+		m_uploaded.clear();
+	}
+	m_uploaded.resize(lists.size());
+
+	size_t firstVertex = 0;
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		const DrawList::Lines &lines       = lists[i]->lines;
+		const size_t           vertexCount = lines.points.size();
+		UploadedList &         uploaded    = m_uploaded[i];
+
+		const bool moved = uploaded.firstVertex != firstVertex || uploaded.vertexCount != vertexCount;
+		if (!moved && uploaded.version != lists[i]->version && uploaded.version == lists[i]->patchedFrom)
+		{
+			for (const PrimitiveRef &primitive : lists[i]->patched)
+			{
+				if (primitive.type == DrawCommandType::LINE)
+					UploadLines(lines, primitive.index, 1, firstVertex);
+			}
+			uploaded.version = lists[i]->version;
+		}
+		else if (uploaded.version != lists[i]->version || moved)
+		{
+			UploadLines(lines, 0, lines.GetCount(), firstVertex);
+
+			uploaded = {
+				.version = lists[i]->version,
+				.firstVertex = firstVertex,
+				.vertexCount = vertexCount,
+			};
+		}
+
+		firstVertex += vertexCount;
+	}
+
+	m_vertexCount = firstVertex;
+
+	UpdateIndices(visibility);
+}
+
+void LineBatcher::Draw() const
+{
+	if (!IsValid() || m_vertexCount == 0)
+		return;
+
+	// Draw whatever rlgl batched so far first, so the lines keep their place in the draw order.
+	rlDrawRenderBatchActive();
+
+	rlEnableShader(m_shader);
+	rlSetUniformMatrix(m_mvpLocation, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+
+	rlEnableVertexArray(m_vertexArray);
+	if (m_drawIndexed)
+	{
+		if (m_indexCount > 0)
+			glDrawElements(RL_LINES, static_cast<int>(m_indexCount), INDEX_TYPE, nullptr);
+	}
+	else
+	{
+		glDrawArrays(RL_LINES, 0, static_cast<int>(m_vertexCount));
+	}
+	rlDisableVertexArray();
+
+	rlDisableShader();
+}
+
+/**
+ * \brief Uploads some of the lines of a list.
+ * \param lines The lines of the list.
+ * \param first The first line to upload.
+ * \param count The number of lines to upload.
+ * \param firstVertex Where the vertices of the list start in the buffers.
+ */
+void LineBatcher::UploadLines(const DrawList::Lines &lines, const size_t first, const size_t count, const size_t firstVertex)
+{
+	if (count == 0)
+		return;
+
+	// Positions are already in raylib space, two per line, and go up as is.
+	const size_t vertexOffset = firstVertex + first * 2;
+	rlUpdateVertexBuffer(m_positionBuffer, lines.points.data() + first * 2, static_cast<int>(count * 2 * sizeof(Vector3)),
+	                     static_cast<int>(vertexOffset * sizeof(Vector3)));
+
+	m_colors.clear();
+	for (size_t i = first; i < first + count; i++)
+	{
+		m_colors.push_back(lines.colors[i]);
+		m_colors.push_back(lines.colors[i]);
+	}
+	rlUpdateVertexBuffer(m_colorBuffer, m_colors.data(), static_cast<int>(count * 2 * sizeof(Color)),
+	                     static_cast<int>(vertexOffset * sizeof(Color)));
+}
+
+/**
+ * \brief Replaces the vertex buffers with empty ones that hold the given number of vertices.
+ * \param vertexCount The number of vertices the new buffers must hold.
+ */
+void LineBatcher::Reserve(const size_t vertexCount)
+{
+	if (m_positionBuffer != 0)
+		rlUnloadVertexBuffer(m_positionBuffer);
+	if (m_colorBuffer != 0)
+		rlUnloadVertexBuffer(m_colorBuffer);
+
+	rlEnableVertexArray(m_vertexArray);
+
+	m_positionBuffer = rlLoadVertexBuffer(nullptr, static_cast<int>(vertexCount * sizeof(Vector3)), true);
+	rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 3, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+
+	m_colorBuffer = rlLoadVertexBuffer(nullptr, static_cast<int>(vertexCount * sizeof(Color)), true);
+	rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+	rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+
+	rlDisableVertexArray();
+
+	m_capacity = vertexCount;
+	m_colors.reserve(vertexCount);
+}
+
+/**
+ * \brief Replaces the index buffer with an empty one that holds the given number of indices.
+ * \param indexCount The number of indices the new buffer must hold.
+ */
+void LineBatcher::ReserveIndices(const size_t indexCount)
+{
+	if (m_indexBuffer != 0)
+		rlUnloadVertexBuffer(m_indexBuffer);
+
+	// The vertex array keeps the element buffer bound while it is.
+	rlEnableVertexArray(m_vertexArray);
+	m_indexBuffer = rlLoadVertexBufferElement(nullptr, static_cast<int>(indexCount * sizeof(uint32_t)), true);
+	rlDisableVertexArray();
+
+	m_indexCapacity = indexCount;
+	m_indices.reserve(indexCount);
+}
+
+/**
+ * \brief Rebuilds the index buffer from the visible lines of each list, if any visibility or list offset changed.
+ * \param visibility The visibility of each list of the last upload, or empty to draw every line.
+ */
+void LineBatcher::UpdateIndices(const std::span<const Visibility> visibility)
+{
+	m_drawIndexed = !visibility.empty();
+	if (!m_drawIndexed)
+	{
+		m_indexedLists.clear();
+		return;
+	}
+
+	bool changed = m_indexedLists.size() != visibility.size();
+	m_indexedLists.resize(visibility.size());
+	for (size_t i = 0; i < visibility.size(); i++)
+	{
+		IndexedList &indexed = m_indexedLists[i];
+		if (indexed.version != visibility[i].version || indexed.firstVertex != m_uploaded[i].firstVertex)
+		{
+			indexed = {
+				.version = visibility[i].version,
+				.firstVertex = m_uploaded[i].firstVertex,
+			};
+			changed = true;
+		}
+	}
+
+	if (!changed)
+		return;
+
+	m_indices.clear();
+	for (size_t i = 0; i < visibility.size(); i++)
+	{
+		const auto firstVertex = static_cast<uint32_t>(m_indexedLists[i].firstVertex);
+		for (const uint32_t line : visibility[i].Get(DrawCommandType::LINE))
+		{
+			m_indices.push_back(firstVertex + line * 2);
+			m_indices.push_back(firstVertex + line * 2 + 1);
+		}
+	}
+
+	if (m_indices.size() > m_indexCapacity)
+	{
+		ReserveIndices(std::max(m_indices.size(), m_indexCapacity * 2));
+	}
+
+	m_indexCount = m_indices.size();
+	if (m_indexCount > 0)
+	{
+		rlEnableVertexArray(m_vertexArray);
+		rlUpdateVertexBufferElements(m_indexBuffer, m_indices.data(), static_cast<int>(m_indexCount * sizeof(uint32_t)), 0);
+		rlDisableVertexArray();
+	}
+}
@@ -0,0 +1,96 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include "config.h"
+#include "Raylib/raymath.h"
+
+// Picking is kept apart from the hierarchy itself, as it is the only part that needs raylib's ray tests
+// rather than just its math, so the ingest core builds without raylib.
+
+namespace
+{
+	// Distance along the ray to its closest approach to the segment, if that is within Config::PICK_LINE_DISTANCE.
+	std::optional<float> GetLineHitDistance(const Ray &ray, const Vector3 &start, const Vector3 &end)
+	{
+		const Vector3 segment = Vector3Subtract(end, start);
+		const Vector3 offset  = Vector3Subtract(ray.position, start);
+		const float   b       = Vector3DotProduct(ray.direction, segment);
+		const float   c       = Vector3DotProduct(segment, segment);
+		const float   d       = Vector3DotProduct(ray.direction, offset);
+		const float   e       = Vector3DotProduct(segment, offset);
+
+		// Closest points of the two lines, then clamped to the ray and the segment.
+		const float denominator = c - b * b;
+		float       s           = denominator > EPSILON ? Clamp((e - b * d) / denominator, 0.0f, 1.0f) : 0.0f;
+		const float t           = fmaxf(b * s - d, 0.0f);
+		if (c > EPSILON)
+		{
+			s = Clamp((t * b + e) / c, 0.0f, 1.0f);
+		}
+
+		const Vector3 onRay     = Vector3Add(ray.position, Vector3Scale(ray.direction, t));
+		const Vector3 onSegment = Vector3Add(start, Vector3Scale(segment, s));
+		if (Vector3Distance(onRay, onSegment) > Config::PICK_LINE_DISTANCE)
+			return std::nullopt;
+		return t;
+	}
+
+	// Circles are picked by the disc they enclose, in the plane DrawCircle3D puts them in.
+	std::optional<float> GetCircleHitDistance(const Ray &ray, const Vector3 &center, const float radius, const Vector3 &axis, const float angle)
+	{
+		const Vector3 normal      = Vector3RotateByAxisAngle({0.0f, 0.0f, 1.0f}, axis, angle * DEG2RAD);
+		const float   denominator = Vector3DotProduct(normal, ray.direction);
+		if (fabsf(denominator) < EPSILON)
+			return std::nullopt;
+
+		const float t = Vector3DotProduct(normal, Vector3Subtract(center, ray.position)) / denominator;
+		if (t < 0.0f)
+			return std::nullopt;
+
+		const Vector3 point = Vector3Add(ray.position, Vector3Scale(ray.direction, t));
+		if (Vector3Distance(point, center) > radius)
+			return std::nullopt;
+		return t;
+	}
+
+	std::optional<float> GetHitDistance(const RayCollision &collision)
+	{
+		return collision.hit ? std::optional(collision.distance) : std::nullopt;
+	}
+
+	std::optional<float> GetHitDistance(const DrawList &list, const PrimitiveRef &primitive, const Ray &ray)
+	{
+		const size_t i = primitive.index;
+		switch (primitive.type)
+		{
+			case DrawCommandType::LINE:
+				return GetLineHitDistance(ray, list.lines.points[i * 2], list.lines.points[i * 2 + 1]);
+			case DrawCommandType::TRIANGLE:
+				return GetHitDistance(GetRayCollisionTriangle(ray, list.triangles.points[i * 3], list.triangles.points[i * 3 + 1],
+				                                              list.triangles.points[i * 3 + 2]));
+			case DrawCommandType::SPHERE:
+				return GetHitDistance(GetRayCollisionSphere(ray, list.spheres.centers[i], list.spheres.radii[i]));
+			case DrawCommandType::CIRCLE:
+				return GetCircleHitDistance(ray, list.circles.centers[i], list.circles.radii[i], list.circles.rotationAxes[i],
+				                            list.circles.rotationAngles[i]);
+			case DrawCommandType::BBOX:
+				return GetHitDistance(GetRayCollisionBox(ray, {list.boxes.mins[i], list.boxes.maxs[i]}));
+			case DrawCommandType::TEXT:
+			default:  // NOLINT(clang-diagnostic-covered-switch-default)
+				return std::nullopt;
+		}
+	}
+}
+
+std::optional<PrimitiveHierarchy::Hit> PrimitiveHierarchy::Raycast(const DrawList &list, const Ray &ray) const
+{
+	// Grown by the line pick distance, so the boxes of lines, which may be flat, still hold everything that picks them.
+	const auto hit = tree.Raycast(ray, Config::PICK_LINE_DISTANCE, [&](const uint32_t payload) -> std::optional<float>
+	{
+		const std::optional<PrimitiveRef> &primitive = (*primitives)[payload];
+		return primitive ? GetHitDistance(list, *primitive, ray) : std::nullopt;
+	});
+
+	if (!hit)
+		return std::nullopt;
+	return Hit{*(*primitives)[hit->payload], hit->leaf, hit->distance};
+}
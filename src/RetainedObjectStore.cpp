@@ -0,0 +1,208 @@
+#include "RetainedObjectStore.h"
+
+#include <initializer_list>
+
+#include "Raylib/raymath.h"
+
+namespace
+{
+	Vector Translate(const Vector &point, const Vector &offset)
+	{
+		return {point.x + offset.x, point.y + offset.y, point.z + offset.z};
+	}
+
+	BoundingBox GetPointBounds(const std::initializer_list<Vector> points)
+	{
+		BoundingBox bounds = {points.begin()->ToRayLib(), points.begin()->ToRayLib()};
+		for (const Vector &point : points)
+		{
+			bounds.min = Vector3Min(bounds.min, point.ToRayLib());
+			bounds.max = Vector3Max(bounds.max, point.ToRayLib());
+		}
+		return bounds;
+	}
+
+	BoundingBox GetSphereBounds(const Vector &center, const float radius)
+	{
+		const Vector3 position = center.ToRayLib();
+		return {Vector3SubtractValue(position, radius), Vector3AddValue(position, radius)};
+	}
+}
+
+DrawCommandPacket RetainedObjectStore::Object::GetTransformed() const
+{
+	DrawCommandPacket transformed = cmd;
+	switch (transformed.type)
+	{
+		case DrawCommandType::LINE:
+			transformed.line.start = Translate(cmd.line.start, offset);
+			transformed.line.end   = Translate(cmd.line.end, offset);
+			break;
+		case DrawCommandType::TRIANGLE:
+			transformed.triangle.p1 = Translate(cmd.triangle.p1, offset);
+			transformed.triangle.p2 = Translate(cmd.triangle.p2, offset);
+			transformed.triangle.p3 = Translate(cmd.triangle.p3, offset);
+			break;
+		case DrawCommandType::SPHERE:
+			transformed.sphere.center = Translate(cmd.sphere.center, offset);
+			break;
+		case DrawCommandType::CIRCLE:
+			transformed.circle.center = Translate(cmd.circle.center, offset);
+			break;
+		case DrawCommandType::BBOX:
+			transformed.box.mins = Translate(cmd.box.mins, offset);
+			transformed.box.maxs = Translate(cmd.box.maxs, offset);
+			break;
+		case DrawCommandType::TEXT:
+			transformed.text.position = Translate(cmd.text.position, offset);
+			break;
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			break;
+	}
+	return transformed;
+}
+
+BoundingBox RetainedObjectStore::Object::GetBounds() const
+{
+	const DrawCommandPacket transformed = GetTransformed();
+	switch (transformed.type)
+	{
+		case DrawCommandType::LINE:
+			return GetPointBounds({transformed.line.start, transformed.line.end});
+		case DrawCommandType::TRIANGLE:
+			return GetPointBounds({transformed.triangle.p1, transformed.triangle.p2, transformed.triangle.p3});
+		case DrawCommandType::SPHERE:
+			return GetSphereBounds(transformed.sphere.center, transformed.sphere.radius);
+		case DrawCommandType::CIRCLE:
+			// Whatever the orientation of a circle, its sphere holds it.
+			return GetSphereBounds(transformed.circle.center, transformed.circle.radius);
+		case DrawCommandType::BBOX:
+			return GetPointBounds({transformed.box.mins, transformed.box.maxs});
+		case DrawCommandType::TEXT:
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			return {};
+	}
+}
+
+RetainedObjectStore::RetainedObjectStore(const size_t capacity) : m_capacity(capacity)
+{
+	m_objects.reserve(capacity);
+	m_indices.reserve(capacity);
+}
+
+RetainedObjectStore::Object *RetainedObjectStore::Create(const uint64_t id, const uint8_t channel, const DrawCommandPacket &cmd)
+{
+	if (Object *existing = Find(id))
+	{
+		m_channelCounts[existing->channel]--;
+		m_channelCounts[channel]++;
+		*existing = {id, channel, cmd, {0.0f, 0.0f, 0.0f}, StringPool::INVALID_ID, existing->leaf};
+		UpdateLeaf(existing - m_objects.data());
+		return existing;
+	}
+
+	if (m_objects.size() == m_capacity)
+		return nullptr;
+
+	m_indices.emplace(id, static_cast<uint32_t>(m_objects.size()));
+	m_channelCounts[channel]++;
+	m_objects.emplace_back(Object{id, channel, cmd, {0.0f, 0.0f, 0.0f}, StringPool::INVALID_ID, BoundingVolumeHierarchy::NULL_NODE});
+	UpdateLeaf(m_objects.size() - 1);
+	return &m_objects.back();
+}
+
+RetainedObjectStore::Object *RetainedObjectStore::Find(const uint64_t id)
+{
+	const auto it = m_indices.find(id);
+	return it != m_indices.end() ? &m_objects[it->second] : nullptr;
+}
+
+void RetainedObjectStore::SetOffset(Object &object, const Vector &offset)
+{
+	object.offset = offset;
+	UpdateLeaf(&object - m_objects.data());
+}
+
+bool RetainedObjectStore::Destroy(const uint64_t id)
+{
+	const auto it = m_indices.find(id);
+	if (it == m_indices.end())
+		return false;
+
+	RemoveAt(it->second);
+	return true;
+}
+
+size_t RetainedObjectStore::DestroyChannel(const uint8_t channel)
+{
+	const size_t count = m_channelCounts[channel];
+
+	// Walk backwards so the objects swapped into a hole have already been looked at.
+	for (size_t i = m_objects.size(); i-- > 0 && m_channelCounts[channel] > 0;)
+	{
+		if (m_objects[i].channel == channel)
+		{
+			RemoveAt(i);
+		}
+	}
+	return count;
+}
+
+void RetainedObjectStore::Clear()
+{
+	m_objects.clear();
+	m_indices.clear();
+	m_hierarchy.Clear();
+	m_channelCounts = {};
+}
+
+void RetainedObjectStore::RemoveAt(const size_t index)
+{
+	m_indices.erase(m_objects[index].id);
+	m_channelCounts[m_objects[index].channel]--;
+	if (m_objects[index].leaf != BoundingVolumeHierarchy::NULL_NODE)
+	{
+		m_hierarchy.Remove(m_objects[index].leaf);
+	}
+
+	// Keep the objects packed by moving the last one into the hole.
+	if (index != m_objects.size() - 1)
+	{
+		m_objects[index]               = m_objects.back();
+		m_indices[m_objects[index].id] = static_cast<uint32_t>(index);
+		if (m_objects[index].leaf != BoundingVolumeHierarchy::NULL_NODE)
+		{
+			m_hierarchy.SetPayload(m_objects[index].leaf, static_cast<uint32_t>(index));
+		}
+	}
+	m_objects.pop_back();
+}
+
+/**
+ * \brief Brings the leaf of an object in line with its geometry: inserted, moved or removed.
+ * \param index The position of the object, which is the payload of its leaf.
+ */
+void RetainedObjectStore::UpdateLeaf(const size_t index)
+{
+	Object &   object  = m_objects[index];
+	const bool hasLeaf = object.leaf != BoundingVolumeHierarchy::NULL_NODE;
+
+	if (object.cmd.type == DrawCommandType::TEXT)
+	{
+		if (hasLeaf)
+		{
+			m_hierarchy.Remove(object.leaf);
+			object.leaf = BoundingVolumeHierarchy::NULL_NODE;
+		}
+		return;
+	}
+
+	if (hasLeaf)
+	{
+		m_hierarchy.Move(object.leaf, object.GetBounds());
+	}
+	else
+	{
+		object.leaf = m_hierarchy.Insert(object.GetBounds(), static_cast<uint32_t>(index));
+	}
+}
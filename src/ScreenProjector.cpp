@@ -0,0 +1,129 @@
+#include "ScreenProjector.h"
+
+#include "Raylib/raymath.h"
+#include "Raylib/rlgl.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SCREEN_PROJECTOR_HAS_SSE_PATH
+#include <xmmintrin.h>
+#endif
+
+ScreenProjector::ScreenProjector(const Camera3D &camera, const int screenWidth, const int screenHeight)
+	: m_width(static_cast<float>(screenWidth)),
+	  m_height(static_cast<float>(screenHeight))
+{
+	// The same matrices GetWorldToScreen builds for a perspective camera. Near and far only affect depth, which is not used.
+	const Matrix projection = MatrixPerspective(camera.fovy * DEG2RAD, static_cast<double>(screenWidth) / static_cast<double>(screenHeight),
+	                                            RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+	const Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+
+	m_viewProjection = MatrixMultiply(view, projection);
+}
+
+void ScreenProjector::ProjectScalar(const std::span<const Vector3> points, ProjectedPoints &out) const
+{
+	out.Clear();
+	ProjectScalar(points, 0, out);
+}
+
+/**
+ * \brief Projects the points from the given index on, appending the visible ones to out.
+ */
+void ScreenProjector::ProjectScalar(const std::span<const Vector3> points, const size_t first, ProjectedPoints &out) const
+{
+	const Matrix &m = m_viewProjection;
+
+	for (size_t i = first; i < points.size(); i++)
+	{
+		const Vector3 &p = points[i];
+
+		// w is the distance in front of the camera, so it doubles as the in front test.
+		// Summed in the same order as the SSE path, so both agree on points right at the screen edge.
+		const float w = (m.m3 * p.x + m.m7 * p.y) + (m.m11 * p.z + m.m15);
+		if (!(w > 0.0f))
+			continue;
+
+		const float x = (m.m0 * p.x + m.m4 * p.y) + (m.m8 * p.z + m.m12);
+		const float y = (m.m1 * p.x + m.m5 * p.y) + (m.m9 * p.z + m.m13);
+
+		const Vector2 screen = {
+			.x = (x / w + 1.0f) * 0.5f * m_width,
+			.y = (1.0f - y / w) * 0.5f * m_height,
+		};
+		if (screen.x >= 0.0f && screen.x < m_width && screen.y >= 0.0f && screen.y < m_height)
+		{
+			out.indices.push_back(static_cast<uint32_t>(i));
+			out.positions.push_back(screen);
+		}
+	}
+}
+
+void ScreenProjector::Project(const std::span<const Vector3> points, ProjectedPoints &out) const
+{
+	out.Clear();
+
+#if defined(SCREEN_PROJECTOR_HAS_SSE_PATH)
+	const Matrix &m = m_viewProjection;
+
+	const __m128 m0 = _mm_set1_ps(m.m0), m4 = _mm_set1_ps(m.m4), m8 = _mm_set1_ps(m.m8), m12 = _mm_set1_ps(m.m12);
+	const __m128 m1 = _mm_set1_ps(m.m1), m5 = _mm_set1_ps(m.m5), m9 = _mm_set1_ps(m.m9), m13 = _mm_set1_ps(m.m13);
+	const __m128 m3 = _mm_set1_ps(m.m3), m7 = _mm_set1_ps(m.m7), m11 = _mm_set1_ps(m.m11), m15 = _mm_set1_ps(m.m15);
+
+	const __m128 zero       = _mm_setzero_ps();
+	const __m128 one        = _mm_set1_ps(1.0f);
+	const __m128 halfWidth  = _mm_set1_ps(0.5f * m_width);
+	const __m128 halfHeight = _mm_set1_ps(0.5f * m_height);
+	const __m128 width      = _mm_set1_ps(m_width);
+	const __m128 height     = _mm_set1_ps(m_height);
+
+	static_assert(sizeof(Vector3) == 3 * sizeof(float), "Four points must be twelve consecutive floats");
+
+	const size_t simdCount = points.size() & ~static_cast<size_t>(3);
+	for (size_t i = 0; i < simdCount; i += 4)
+	{
+		// Transpose four xyz points into one register per coordinate.
+		const float *p = &points[i].x;
+		const __m128 a = _mm_loadu_ps(p);     // x0 y0 z0 x1
+		const __m128 b = _mm_loadu_ps(p + 4); // y1 z1 x2 y2
+		const __m128 c = _mm_loadu_ps(p + 8); // z2 x3 y3 z3
+
+		const __m128 px = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		const __m128 py = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+		                                 _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 pz = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+		                                 _MM_SHUFFLE(2, 0, 2, 0));
+
+		const __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m4, py)), _mm_add_ps(_mm_mul_ps(m8, pz), m12));
+		const __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, px), _mm_mul_ps(m5, py)), _mm_add_ps(_mm_mul_ps(m9, pz), m13));
+		const __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, px), _mm_mul_ps(m7, py)), _mm_add_ps(_mm_mul_ps(m11, pz), m15));
+
+		const __m128 screenX = _mm_mul_ps(_mm_add_ps(_mm_div_ps(x, w), one), halfWidth);
+		const __m128 screenY = _mm_mul_ps(_mm_sub_ps(one, _mm_div_ps(y, w)), halfHeight);
+
+		// In front of the camera and inside the screen, all four lanes at once.
+		const __m128 visible = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(w, zero),
+		                                             _mm_and_ps(_mm_cmpge_ps(screenX, zero), _mm_cmplt_ps(screenX, width))),
+		                                  _mm_and_ps(_mm_cmpge_ps(screenY, zero), _mm_cmplt_ps(screenY, height)));
+
+		int mask = _mm_movemask_ps(visible);
+		if (mask == 0)
+			continue;
+
+		alignas(16) float xs[4], ys[4];
+		_mm_store_ps(xs, screenX);
+		_mm_store_ps(ys, screenY);
+		for (int lane = 0; mask != 0; lane++, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				out.indices.push_back(static_cast<uint32_t>(i + lane));
+				out.positions.push_back({xs[lane], ys[lane]});
+			}
+		}
+	}
+
+	ProjectScalar(points, simdCount, out);
+#else
+	ProjectScalar(points, 0, out);
+#endif
+}
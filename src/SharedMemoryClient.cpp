@@ -1,98 +1,47 @@
 #include "SharedMemoryClient.h"
 
+#include <algorithm>
 #include <iostream>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "config.h"
 
 SharedMemoryClient::~SharedMemoryClient()
 {
 	Stop();
 }
 
-bool SharedMemoryClient::Start(std::atomic<bool> &running, rlFPCamera &camera)
+bool SharedMemoryClient::Start(std::atomic<bool> &running)
 {
-	// 1. Open the event used for signaling.
-	m_hEvent = OpenEventW(SYNCHRONIZE, FALSE, EVENT_NAME);
-	if (m_hEvent == nullptr)
-	{
-		const DWORD error = GetLastError();
-		std::cerr << "Client: OpenEvent failed, GLE=" << error;
-		switch (error)
-		{
-			case ERROR_FILE_NOT_FOUND:
-				std::cerr << " (Event not found - server may not be running)";
-				break;
-			case ERROR_ACCESS_DENIED:
-				std::cerr << " (Access denied - insufficient permissions)";
-				break;
-			default:
-				break;
-		}
-		std::cerr << ". Is the server running?\n";
-		return false;
-	}
-
-	// 2. Open the file mapping object.
-	m_hMapFile = OpenFileMappingW(
-	                              FILE_MAP_ALL_ACCESS, // Read-only access
-	                              FALSE,               // Do not inherit the name
-	                              SHARED_MEM_NAME      // Name of mapping object
-	                             );
+	return Start(running, CreateSharedMemoryTransport());
+}
 
-	if (m_hMapFile == nullptr)
+bool SharedMemoryClient::Start(std::atomic<bool> &running, std::unique_ptr<SharedMemoryTransport> transport)
+{
+	// 1. Open and map the platform specific shared memory objects.
+	m_transport = std::move(transport);
+	if (!m_transport->Open())
 	{
-		const DWORD error = GetLastError();
-		std::cerr << "Client: OpenFileMapping failed, GLE=" << error;
-		switch (error)
-		{
-			case ERROR_FILE_NOT_FOUND:
-				std::cerr << " (Shared memory not found - server may not be running)";
-				break;
-			case ERROR_ACCESS_DENIED:
-				std::cerr << " (Access denied - insufficient permissions)";
-				break;
-			default:
-				break;
-		}
-		std::cerr << "\n";
 		Stop();
 		return false;
 	}
 
-	// 3. Map the view of the file.
-	m_pSharedMem = static_cast<SharedMemoryLayout*>(MapViewOfFile(
-	                                                              m_hMapFile,
-	                                                              FILE_MAP_ALL_ACCESS,
-	                                                              0,
-	                                                              0,
-	                                                              sizeof(SharedMemoryLayout)
-	                                                             ));
+	m_pSharedMem     = m_transport->GetLayout();
+	m_pBuffer        = m_pSharedMem->GetBuffer();
+	m_capacity       = m_transport->GetCapacity();
+	m_ringMirrored   = m_transport->IsMirrored();
+	m_checkedFraming = (m_pSharedMem->features & SharedMemFeature::CHECKED_FRAMING) != 0;
+	m_cameraRegister = (m_pSharedMem->features & SharedMemFeature::CAMERA_REGISTER) != 0;
 
-	if (m_pSharedMem == nullptr)
-	{
-		const DWORD error = GetLastError();
-		std::cerr << "Client: MapViewOfFile failed, GLE=" << error;
-		switch (error)
-		{
-			case ERROR_ACCESS_DENIED:
-				std::cerr << " (Access denied - permission mismatch or insufficient privileges)";
-				break;
-			case ERROR_INVALID_PARAMETER:
-				std::cerr << " (Invalid parameter - size or offset issue)";
-				break;
-			case ERROR_NOT_ENOUGH_MEMORY:
-				std::cerr << " (Not enough memory)";
-				break;
-			default:
-				break;
-		}
-		std::cerr << "\n";
-		Stop();
-		return false;
-	}
+	std::cout << "Client: Buffer capacity " << m_capacity / 1024 << "KB" << (m_ringMirrored ? ", mirrored" : "")
+		<< (m_checkedFraming ? ", checked framing" : "") << (m_cameraRegister ? ", camera register" : "") << ".\n";
 
-	// 4. Start the worker thread.
+	// 2. Start the worker thread.
 	try
 	{
-		m_clientThread = std::thread(&SharedMemoryClient::ClientThreadWorker, this, std::ref(running), std::ref(camera));
+		m_clientThread = std::thread(&SharedMemoryClient::ClientThreadWorker, this, std::ref(running));
 	}
 	catch (const std::exception &e)
 	{
@@ -109,10 +58,10 @@ void SharedMemoryClient::Stop()
 {
 	m_stopThread = true;
 
-	// Signal the event to make sure the worker thread is not stuck waiting.
-	if (m_hEvent)
+	// Signal the transport to make sure the worker thread is not stuck waiting.
+	if (m_transport)
 	{
-		SetEvent(m_hEvent);
+		m_transport->Wake();
 	}
 
 	if (m_clientThread.joinable())
@@ -120,22 +69,21 @@ void SharedMemoryClient::Stop()
 		m_clientThread.join();
 	}
 
-	if (m_pSharedMem != nullptr)
-	{
-		UnmapViewOfFile(m_pSharedMem);
-		m_pSharedMem = nullptr;
-	}
+	m_pSharedMem     = nullptr;
+	m_pBuffer        = nullptr;
+	m_capacity       = 0;
+	m_ringMirrored   = false;
+	m_checkedFraming = false;
 
-	if (m_hMapFile != nullptr)
-	{
-		CloseHandle(m_hMapFile);
-		m_hMapFile = nullptr;
-	}
+	// A reconnect may find a server without the register, or one that starts its sequence over.
+	m_cameraRegister   = false;
+	m_registerHistory  = {};
+	m_registerSequence = 0;
 
-	if (m_hEvent != nullptr)
+	if (m_transport)
 	{
-		CloseHandle(m_hEvent);
-		m_hEvent = nullptr;
+		m_transport->Close();
+		m_transport.reset();
 	}
 }
 
@@ -150,81 +98,274 @@ void SharedMemoryClient::ReadFromBuffer(void *dest, const size_t offset, const s
 	const size_t endPos = offset + size;
 	auto *       dst    = static_cast<std::byte*>(dest);
 
-	if (endPos > SHARED_MEM_BUFFER_SIZE)
+	if (endPos > m_capacity && !m_ringMirrored)
 	{
 		// Data wraps around the buffer, requiring two copies.
-		const size_t firstPartSize = SHARED_MEM_BUFFER_SIZE - offset;
-		memcpy(dst, m_pSharedMem->buffer + offset, firstPartSize);
-		memcpy(dst + firstPartSize, m_pSharedMem->buffer, size - firstPartSize);
+		const size_t firstPartSize = m_capacity - offset;
+		memcpy(dst, m_pBuffer + offset, firstPartSize);
+		memcpy(dst + firstPartSize, m_pBuffer, size - firstPartSize);
 	}
 	else
 	{
-		// Data is contiguous and can be read in a single copy.
-		memcpy(dst, m_pSharedMem->buffer + offset, size);
+		// Data is contiguous (or the buffer is mirrored) and can be read in a single copy.
+		memcpy(dst, m_pBuffer + offset, size);
 	}
 }
 
-void SharedMemoryClient::ClientThreadWorker(const std::atomic<bool> &running, rlFPCamera &camera)
+/**
+ * \brief Returns a pointer to a packet payload without copying it out of the circular buffer where possible.
+ * \param offset The starting position of the payload in the shared buffer.
+ * \param size The size of the payload in bytes.
+ * \return A view straight into shared memory if the payload is contiguous, otherwise the reusable
+ *         scratch buffer holding a copy of the wrapped payload. Only valid until the next call.
+ */
+const std::byte *SharedMemoryClient::GetPacketData(const size_t offset, const size_t size)
+{
+	if (offset + size <= m_capacity || m_ringMirrored)
+	{
+		// Contiguous payload (or the buffer is mirrored), decode it straight out of the shared buffer.
+		return m_pBuffer + offset;
+	}
+
+	// The payload wraps around the end of the buffer. The scratch buffer only grows,
+	// so after warm-up this path does not allocate either.
+	if (m_scratchBuffer.size() < size)
+	{
+		m_scratchBuffer.resize(size);
+	}
+
+	ReadFromBuffer(m_scratchBuffer.data(), offset, size);
+	return m_scratchBuffer.data();
+}
+
+/**
+ * \brief Reads and validates the header of the packet at the given position.
+ * \param offset The position of the packet in the shared buffer.
+ * \param available The number of published bytes from offset up to head.
+ * \param header Receives the type and data size of the packet.
+ * \param packetSize Receives the size of the packet including its header.
+ * \return A pointer to the packet data (see GetPacketData), or nullptr if no valid packet starts at offset.
+ */
+const std::byte *SharedMemoryClient::ReadPacket(const size_t offset, const size_t available, PacketHeader &header, size_t &packetSize)
+{
+	size_t   headerSize;
+	uint32_t checksum = 0;
+	if (m_checkedFraming)
+	{
+		FramedPacketHeader framed;
+		if (available < sizeof(framed))
+			return nullptr;
+
+		ReadFromBuffer(&framed, offset, sizeof(framed));
+		if (framed.sync != SHARED_MEM_SYNC_WORD || framed.size > available - sizeof(framed))
+			return nullptr;
+
+		header     = {framed.type, framed.size};
+		headerSize = sizeof(framed);
+		checksum   = framed.checksum;
+	}
+	else
+	{
+		if (available < sizeof(header))
+			return nullptr;
+
+		ReadFromBuffer(&header, offset, sizeof(header));
+		if (header.size > available - sizeof(header))
+			return nullptr;
+
+		headerSize = sizeof(header);
+	}
+
+	// The server only publishes whole packets, so the data is complete if the size fits before head.
+	const std::byte *data = GetPacketData((offset + headerSize) & (m_capacity - 1), header.size);
+
+	if (m_checkedFraming && ComputePacketChecksum(header.type, header.size, data) != checksum)
+	{
+		m_checksumFailures.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	packetSize = headerSize + header.size;
+	return data;
+}
+
+/**
+ * \brief Finds the next sync word after a packet that failed validation.
+ * \param offset The position of the invalid packet in the shared buffer.
+ * \param available The number of published bytes from offset up to head.
+ * \return The number of bytes to skip to reach the next sync word, or available if there is none before head.
+ */
+size_t SharedMemoryClient::FindNextSyncWord(const size_t offset, const size_t available) const
+{
+	for (size_t skip = 1; skip + sizeof(SHARED_MEM_SYNC_WORD) <= available; skip++)
+	{
+		uint32_t word;
+		ReadFromBuffer(&word, (offset + skip) & (m_capacity - 1), sizeof(word));
+		if (word == SHARED_MEM_SYNC_WORD)
+			return skip;
+	}
+
+	return available;
+}
+
+void SharedMemoryClient::ClientThreadWorker(const std::atomic<bool> &running)
 {
 	while (running && !m_stopThread && m_pSharedMem)
 	{
-		// Wait for the server to signal that new data is available.
-		const DWORD waitResult = WaitForSingleObject(m_hEvent, 30); // 30ms timeout
+		std::atomic_ref<size_t> sharedHead(m_pSharedMem->head);
+		std::atomic_ref<size_t> sharedTail(m_pSharedMem->tail);
 
-		if (waitResult != WAIT_OBJECT_0)
+		// We are the only writer of tail, a relaxed load of our own value is enough.
+		size_t tail = sharedTail.load(std::memory_order_relaxed);
+
+		// Wait for the server to publish new data.
+		if (!m_waitStrategy.Wait(*m_transport, *m_pSharedMem, tail))
 			continue; // Timeout or error, loop again.
 
-		// Use a memory barrier to ensure we see the head value that was set *after*
-		// the server finished writing the data.
-		_ReadBarrier();
+		// Acquire pairs with the server's release store, so everything up to head has been written.
+		size_t head = sharedHead.load(std::memory_order_acquire);
 
-		size_t head = m_pSharedMem->head;
-		size_t tail = m_pSharedMem->tail;
+		// Bytes consumed since tail was last published to the server.
+		size_t unpublished = 0;
 
 		while (tail != head)
 		{
-			// Read packet header using the safe helper function. This prevents a buffer
-			// over-read if the header itself wraps around the end of the buffer.
-			PacketHeader header;
-			ReadFromBuffer(&header, tail, sizeof(header));
+			const size_t available = (head - tail) & (m_capacity - 1);
 
-			const uint32_t totalPacketSize = sizeof(PacketHeader) + header.size;
+			PacketHeader     header;
+			size_t           packetSize;
+			const std::byte *data = ReadPacket(tail, available, header, packetSize);
 
-			// If the packet size is nonsensical,
-			// the buffer is likely corrupted. We can try to recover by skipping all data.
-			if (totalPacketSize > SHARED_MEM_BUFFER_SIZE)
+			if (data)
+			{
+				// Process the packet in place. The server cannot overwrite it until we publish a tail past it.
+				ProcessPacket(header, data);
+			}
+			else if (m_checkedFraming)
 			{
+				// Drop bytes up to the next sync word and try to pick the stream up again from there.
+				packetSize = FindNextSyncWord(tail, available);
+				m_resyncCount.fetch_add(1, std::memory_order_relaxed);
+				m_bytesSkipped.fetch_add(packetSize, std::memory_order_relaxed);
+			}
+			else
+			{
+				// Without sync words there is no way to find the next packet boundary, skip all pending data.
 				std::cerr << "Client: Corrupted packet detected (size too large). Flushing buffer.\n";
-				m_pSharedMem->tail = head; // Skip all pending data.
+				tail = head;
 				break;
 			}
 
-			const size_t dataStart = (tail + sizeof(PacketHeader)) & (SHARED_MEM_BUFFER_SIZE - 1);
+			tail = (tail + packetSize) & (m_capacity - 1);
+			unpublished += packetSize;
 
-			// Read packet data
-			std::vector<std::byte> dataBuffer(header.size);
-			if (header.size > 0)
+			// Release the space back to the server in chunks rather than per packet,
+			// so the tail cache line is not bounced to the server on every command.
+			if (unpublished >= m_tailPublishBytes)
 			{
-				ReadFromBuffer(dataBuffer.data(), dataStart, header.size);
+				sharedTail.store(tail, std::memory_order_release);
+				unpublished = 0;
 			}
 
-			// Process the packet we just read
-			ProcessPacket(header, dataBuffer.data(), camera);
+			// Only touch the server's cache line again once we caught up with the head we know about.
+			if (tail == head)
+			{
+				// Hand the renderer what we have so far, so a server that keeps us busy does not starve it.
+				PublishDrawCommands();
+				head = sharedHead.load(std::memory_order_acquire);
+			}
+		}
 
-			// Atomically update the tail to release the space back to the server.
-			tail               = (tail + totalPacketSize) & (SHARED_MEM_BUFFER_SIZE - 1);
-			m_pSharedMem->tail = tail;
+		// Publish whatever is left of the drained batch.
+		sharedTail.store(tail, std::memory_order_release);
+		PublishDrawCommands();
+	}
+	if (m_pSharedMem)
+	{
+		m_waitStrategy.OnStop(*m_pSharedMem);
+	}
 
-			// Re-read head for the next iteration in case the server wrote more data
-			// while we were processing this packet.
-			_ReadBarrier();
-			head = m_pSharedMem->head;
-		}
+	m_waitStrategy.PrintStats(std::cout);
+	if (const IngestStats stats = GetStats(); stats.resyncs != 0)
+	{
+		std::cout << "Client: Resynchronized " << stats.resyncs << " times (" << stats.checksumFailures << " checksum failures), skipped "
+		          << stats.bytesSkipped << " bytes.\n";
+	}
+	if (const uint64_t duplicates = m_drawCommands.GetDuplicateCount())
+	{
+		const uint64_t total = duplicates + m_drawCommands.GetInsertCount();
+		std::cout << "Client: Deduplicated " << duplicates << " of " << total << " draw commands ("
+		          << 100.0 * static_cast<double>(duplicates) / static_cast<double>(total) << "%).\n";
 	}
 	std::cout << "Client worker thread finished.\n";
 }
 
-void SharedMemoryClient::ProcessPacket(const PacketHeader &header, const std::byte *data, rlFPCamera &camera)
+namespace
+{
+	// The text of a command, which is not necessarily null-terminated when it comes straight from the server.
+	std::string_view GetTextView(const TextCommandData &text)
+	{
+		return {text.text, strnlen(text.text, sizeof(text.text) - 1)};
+	}
+
+	template <typename T>
+	std::optional<DrawCommandPacket> DecodeCompactPayload(const CompactDrawHeader &header, const std::byte *payload, const size_t size)
+	{
+		if (size != sizeof(T))
+			return std::nullopt;
+
+		return DrawCommandPacket(header.type, header.color, header.drawEndTime, *reinterpret_cast<const T*>(payload));
+	}
+
+	/**
+	 * \brief Expands a DRAW_COMMAND_COMPACT payload back into a DrawCommandPacket.
+	 * \return The command, or std::nullopt if the type is unknown or the size does not match it.
+	 */
+	std::optional<DrawCommandPacket> DecodeCompactDrawCommand(const std::byte *data, const size_t size)
+	{
+		if (size < sizeof(CompactDrawHeader))
+			return std::nullopt;
+
+		const auto &     header      = *reinterpret_cast<const CompactDrawHeader*>(data);
+		const std::byte *payload     = data + sizeof(CompactDrawHeader);
+		const size_t     payloadSize = size - sizeof(CompactDrawHeader);
+
+		switch (header.type)
+		{
+			case DrawCommandType::LINE:
+				return DecodeCompactPayload<LineCommandData>(header, payload, payloadSize);
+			case DrawCommandType::TRIANGLE:
+				return DecodeCompactPayload<TriangleCommandData>(header, payload, payloadSize);
+			case DrawCommandType::SPHERE:
+				return DecodeCompactPayload<SphereCommandData>(header, payload, payloadSize);
+			case DrawCommandType::CIRCLE:
+				return DecodeCompactPayload<CircleCommandData>(header, payload, payloadSize);
+			case DrawCommandType::BBOX:
+				return DecodeCompactPayload<BBoxCommandData>(header, payload, payloadSize);
+			case DrawCommandType::TEXT:
+			{
+				if (payloadSize < sizeof(CompactTextData))
+					return std::nullopt;
+
+				const auto &text = *reinterpret_cast<const CompactTextData*>(payload);
+				if (text.length > MAX_COMPACT_TEXT_LENGTH || payloadSize != sizeof(CompactTextData) + text.length)
+					return std::nullopt;
+
+				char message[MAX_COMPACT_TEXT_LENGTH + 1];
+				memcpy(message, payload + sizeof(CompactTextData), text.length);
+				message[text.length] = '\0';
+
+				DrawCommandPacket cmd(header.type, header.color, header.drawEndTime, TextCommandData(text.position, message));
+				cmd.text.onscreen = text.onscreen;
+				return cmd;
+			}
+			default:  // NOLINT(clang-diagnostic-covered-switch-default)
+				return std::nullopt;
+		}
+	}
+}
+
+void SharedMemoryClient::ProcessPacket(const PacketHeader &header, const std::byte *data)
 {
 	switch (header.type)
 	{
@@ -237,12 +378,111 @@ void SharedMemoryClient::ProcessPacket(const PacketHeader &header, const std::by
 				break;
 			}
 
-			std::lock_guard lock(m_drawMutex);
-			if (m_drawCommands.size() > MAX_DRAW_COMMANDS)
+			AddDrawCommand(*reinterpret_cast<const DrawCommandPacket*>(data));
+			break;
+		}
+		case PacketType::DRAW_COMMAND_COMPACT:
+		{
+			const std::optional<DrawCommandPacket> cmd = DecodeCompactDrawCommand(data, header.size);
+			if (!cmd)
+			{
+				std::cerr << "Client: Received malformed DRAW_COMMAND_COMPACT of size " << header.size << ".\n";
+				break;
+			}
+
+			AddDrawCommand(*cmd);
+			break;
+		}
+		case PacketType::DRAW_BATCH:
+		{
+			if (header.size < sizeof(DrawBatchHeader))
+			{
+				std::cerr << "Client: Received DRAW_BATCH smaller than its header.\n";
+				break;
+			}
+
+			const auto & batch    = *reinterpret_cast<const DrawBatchHeader*>(data);
+			const size_t itemSize = GetDrawBatchItemSize(batch.type, batch.layout);
+
+			if (itemSize == 0 || header.size != sizeof(DrawBatchHeader) + static_cast<size_t>(batch.count) * itemSize)
+			{
+				std::cerr << "Client: Received malformed DRAW_BATCH of " << batch.count << " items, size " << header.size << ".\n";
+				break;
+			}
+
+			AddDrawBatch(batch, data + sizeof(DrawBatchHeader));
+			break;
+		}
+		case PacketType::RETAINED_CREATE:
+		{
+			if (header.size < sizeof(RetainedCreateHeader))
+			{
+				std::cerr << "Client: Received RETAINED_CREATE smaller than its header.\n";
+				break;
+			}
+
+			CreateRetainedObject(*reinterpret_cast<const RetainedCreateHeader*>(data), data + sizeof(RetainedCreateHeader), header.size - sizeof(RetainedCreateHeader));
+			break;
+		}
+		case PacketType::RETAINED_UPDATE:
+		{
+			if (header.size != sizeof(RetainedUpdateData))
+			{
+				std::cerr << "Client: Received RETAINED_UPDATE with incorrect size. Expected "
+						<< sizeof(RetainedUpdateData) << ", got " << header.size << ".\n";
+				break;
+			}
+
+			UpdateRetainedObject(*reinterpret_cast<const RetainedUpdateData*>(data));
+			break;
+		}
+		case PacketType::RETAINED_DESTROY:
+		{
+			if (header.size != sizeof(RetainedDestroyData))
 			{
-				m_drawCommands.erase(m_drawCommands.begin());
+				std::cerr << "Client: Received RETAINED_DESTROY with incorrect size. Expected "
+						<< sizeof(RetainedDestroyData) << ", got " << header.size << ".\n";
+				break;
 			}
-			m_drawCommands.push_back(*reinterpret_cast<const DrawCommandPacket*>(data));
+
+			DestroyRetainedObject(*reinterpret_cast<const RetainedDestroyData*>(data));
+			break;
+		}
+		case PacketType::SET_CHANNEL:
+		{
+			if (header.size != sizeof(SetChannelData))
+			{
+				std::cerr << "Client: Received SET_CHANNEL with incorrect size. Expected "
+						<< sizeof(SetChannelData) << ", got " << header.size << ".\n";
+				break;
+			}
+
+			m_currentChannel = reinterpret_cast<const SetChannelData*>(data)->channel;
+			break;
+		}
+		case PacketType::CLEAR_CHANNEL:
+		{
+			if (header.size != sizeof(ClearChannelData))
+			{
+				std::cerr << "Client: Received CLEAR_CHANNEL with incorrect size. Expected "
+						<< sizeof(ClearChannelData) << ", got " << header.size << ".\n";
+				break;
+			}
+
+			ClearChannel(reinterpret_cast<const ClearChannelData*>(data)->channel);
+			break;
+		}
+		case PacketType::SET_CHANNEL_VISIBLE:
+		{
+			if (header.size != sizeof(SetChannelVisibleData))
+			{
+				std::cerr << "Client: Received SET_CHANNEL_VISIBLE with incorrect size. Expected "
+						<< sizeof(SetChannelVisibleData) << ", got " << header.size << ".\n";
+				break;
+			}
+
+			const auto &visibility = *reinterpret_cast<const SetChannelVisibleData*>(data);
+			SetChannelVisible(visibility.channel, visibility.visible);
 			break;
 		}
 		case PacketType::WORLD_UPDATE:
@@ -266,11 +506,12 @@ void SharedMemoryClient::ProcessPacket(const PacketHeader &header, const std::by
 
 			ExpireOldCommands();
 
-			rlFPCameraSetPosition(&camera, worldUpdate.origin.ToRayLib());
-			camera.ViewAngles = {
-				.x = -worldUpdate.viewAngles.y * DEG2RAD,
-				.y = worldUpdate.viewAngles.x * DEG2RAD,
-			};
+			// With the camera register, the render thread takes the camera from there instead.
+			if (!m_cameraRegister)
+			{
+				m_cameraHistory.Push(worldUpdate, CameraState::Clock::now());
+				m_cameraState.Store(m_cameraHistory);
+			}
 			break;
 		}
 		case PacketType::CLEAR_ALL_DRAWINGS:
@@ -286,27 +527,467 @@ void SharedMemoryClient::ProcessPacket(const PacketHeader &header, const std::by
 	}
 }
 
-std::vector<DrawCommandPacket> SharedMemoryClient::GetDrawCommands()
+void SharedMemoryClient::AddDrawCommand(const DrawCommandPacket &cmd)
+{
+	// Hidden channels are not rendered, so do not spend any storage on them either.
+	if (m_hiddenChannels[m_currentChannel])
+		return;
+
+	const DrawCommandStore::SlotIndex slot = m_drawCommands.Insert(m_currentChannel, cmd);
+	if (cmd.type == DrawCommandType::TEXT)
+	{
+		m_textIds[slot] = InternText(cmd.text);
+	}
+	m_drawCommandsChanged = true;
+}
+
+/**
+ * \brief Appends every primitive of a validated DRAW_BATCH.
+ * \param batch The batch header, its item size must already have been checked against the packet size.
+ * \param items The packed items following the header.
+ */
+void SharedMemoryClient::AddDrawBatch(const DrawBatchHeader &batch, const std::byte *items)
+{
+	// A polyline of N points makes N - 1 segments.
+	size_t count = batch.count;
+	if (batch.layout == DrawBatchLayout::POLYLINE)
+	{
+		count = count > 0 ? count - 1 : 0;
+	}
+
+	if (m_hiddenChannels[m_currentChannel])
+		return;
+
+	// Only the newest commands of an oversized batch would survive anyway.
+	const size_t capacity = m_drawCommands.GetCapacity();
+	const size_t skip     = count > capacity ? count - capacity : 0;
+
+	m_drawCommandsChanged = true;
+
+	const auto appendItems = [&]<typename T>()
+	{
+		// The *CommandData structs are packed, so reading them in place is fine at any alignment.
+		const auto *typedItems = reinterpret_cast<const T*>(items) + skip;
+		m_drawCommands.InsertBatch(m_currentChannel, count - skip, [&](const size_t i)
+		{
+			return DrawCommandPacket(batch.type, batch.color, batch.drawEndTime, typedItems[i]);
+		});
+	};
+
+	if (batch.layout == DrawBatchLayout::POLYLINE)
+	{
+		const std::byte *points = items + skip * sizeof(Vector);
+		m_drawCommands.InsertBatch(m_currentChannel, count - skip, [&](const size_t i)
+		{
+			// Vector is not packed, copy the points out to avoid unaligned access.
+			Vector start, end;
+			memcpy(&start, points + i * sizeof(Vector), sizeof(Vector));
+			memcpy(&end, points + (i + 1) * sizeof(Vector), sizeof(Vector));
+			return DrawCommandPacket(batch.type, batch.color, batch.drawEndTime, LineCommandData(start, end));
+		});
+		return;
+	}
+
+	switch (batch.type)
+	{
+		case DrawCommandType::LINE:
+			appendItems.operator()<LineCommandData>();
+			break;
+		case DrawCommandType::TRIANGLE:
+			appendItems.operator()<TriangleCommandData>();
+			break;
+		case DrawCommandType::SPHERE:
+			appendItems.operator()<SphereCommandData>();
+			break;
+		case DrawCommandType::CIRCLE:
+			appendItems.operator()<CircleCommandData>();
+			break;
+		case DrawCommandType::BBOX:
+			appendItems.operator()<BBoxCommandData>();
+			break;
+		default:  // NOLINT(clang-diagnostic-covered-switch-default)
+			break;
+	}
+}
+
+/**
+ * \brief Creates a retained object, or replaces the one with the same id.
+ * \param create The header carrying the object id.
+ * \param data The object as a DRAW_COMMAND_COMPACT payload.
+ * \param size The size of the payload in bytes.
+ */
+void SharedMemoryClient::CreateRetainedObject(const RetainedCreateHeader &create, const std::byte *data, const size_t size)
+{
+	const std::optional<DrawCommandPacket> cmd = DecodeCompactDrawCommand(data, size);
+	if (!cmd)
+	{
+		std::cerr << "Client: Received malformed RETAINED_CREATE of size " << size << ".\n";
+		return;
+	}
+
+	RetainedObjectStore::Object *object = m_retainedObjects.Create(create.id, m_currentChannel, *cmd);
+	if (!object)
+	{
+		std::cerr << "Client: Too many retained objects, dropping " << create.id << ".\n";
+		return;
+	}
+
+	if (cmd->type == DrawCommandType::TEXT)
+	{
+		object->textId = InternText(cmd->text);
+	}
+	m_retainedChanged = true;
+}
+
+void SharedMemoryClient::UpdateRetainedObject(const RetainedUpdateData &update)
+{
+	RetainedObjectStore::Object *object = m_retainedObjects.Find(update.id);
+	if (!object)
+		return;
+
+	if (update.fields & RetainedUpdateField::COLOR)
+	{
+		object->cmd.color = update.color;
+	}
+	if (update.fields & RetainedUpdateField::OFFSET)
+	{
+		m_retainedObjects.SetOffset(*object, update.offset);
+		m_retainedMoved = true;
+	}
+
+	// Past one update per object, rebuilding the list is cheaper than patching it.
+	if (m_retainedUpdates.size() < m_retainedObjects.GetSize())
+		m_retainedUpdates.push_back(static_cast<uint32_t>(object - m_retainedObjects.GetObjects().data()));
+	else
+		m_retainedChanged = true;
+}
+
+void SharedMemoryClient::DestroyRetainedObject(const RetainedDestroyData &destroy)
+{
+	if (m_retainedObjects.Destroy(destroy.id))
+	{
+		m_retainedChanged = true;
+	}
+}
+
+/**
+ * \brief Removes the draw commands and retained objects of one channel, leaving the other channels alone.
+ */
+void SharedMemoryClient::ClearChannel(const uint8_t channel)
+{
+	if (m_drawCommands.RemoveChannel(channel) > 0)
+	{
+		m_drawCommandsChanged = true;
+	}
+	if (m_retainedObjects.DestroyChannel(channel) > 0)
+	{
+		m_retainedChanged = true;
+	}
+}
+
+/**
+ * \brief Shows or hides a channel. Hiding drops its draw commands and any that arrive while it is hidden.
+ * Retained objects are kept, they are only left out of the snapshots until the channel is shown again.
+ */
+void SharedMemoryClient::SetChannelVisible(const uint8_t channel, const bool visible)
+{
+	if (m_hiddenChannels[channel] == !visible)
+		return;
+
+	m_hiddenChannels[channel] = !visible;
+	if (m_retainedObjects.GetChannelCount(channel) > 0)
+	{
+		m_retainedChanged = true;
+	}
+
+	if (!visible && m_drawCommands.RemoveChannel(channel) > 0)
+	{
+		m_drawCommandsChanged = true;
+	}
+}
+
+const DrawSnapshot &SharedMemoryClient::GetDrawCommands()
+{
+	return m_drawSnapshots.Acquire();
+}
+
+bool SharedMemoryClient::GetCameraState(CameraState &state)
+{
+	if (!m_cameraRegister || !m_pSharedMem)
+	{
+		state = m_cameraState.Load();
+		return true;
+	}
+
+	// Read the register directly, so a backlog of draw commands in the buffer cannot delay the camera.
+	CameraRegister camera;
+	if (!ReadCameraRegister(*m_pSharedMem, camera))
+		return false;
+
+	if (camera.sequence != m_registerSequence)
+	{
+		m_registerHistory.Push(WorldUpdatePacket(camera.viewAngles, camera.origin, camera.curtime), CameraState::Clock::now());
+		m_registerSequence = camera.sequence;
+	}
+	state = m_registerHistory;
+	return true;
+}
+
+IngestStats SharedMemoryClient::GetStats() const
+{
+	return {
+		.checksumFailures = m_checksumFailures.load(std::memory_order_relaxed),
+		.resyncs = m_resyncCount.load(std::memory_order_relaxed),
+		.bytesSkipped = m_bytesSkipped.load(std::memory_order_relaxed),
+		.signalsSent = m_waitStrategy.GetSignalsSent(),
+		.signalsElided = m_waitStrategy.GetSignalsElided(),
+	};
+}
+
+/**
+ * \brief Hands a copy of the current draw commands to the render thread, if they changed since the last one.
+ * The copy is made once per drained batch of packets on the worker thread, instead of once per frame.
+ */
+void SharedMemoryClient::PublishDrawCommands()
+{
+	if (!m_drawCommandsChanged && !m_retainedChanged && m_retainedUpdates.empty())
+		return;
+
+	if (m_retainedChanged || !m_retainedUpdates.empty())
+	{
+		UpdateRetainedList();
+	}
+
+	DrawSnapshot &snapshot = m_drawSnapshots.GetBack();
+	snapshot.commands.Clear();
+	m_drawCommands.ForEach([this, &snapshot](const DrawCommandPacket &cmd, const DrawCommandStore::SlotIndex slot){
+		snapshot.commands.Add(cmd, m_textIds[slot]);
+	});
+	snapshot.commands.strings = m_strings;
+	snapshot.commands.version = ++m_listVersion;
+	snapshot.retained         = m_retainedList;
+
+	m_drawSnapshots.Publish();
+	m_drawCommandsChanged = false;
+}
+
+/**
+ * \brief Brings m_retainedList up to date with the retained objects, in a list no snapshot refers to anymore.
+ * If the objects were only updated since that list was built, just the updated ones are written over it,
+ * and the list records them so the renderer can upload only those too. Otherwise the list is rebuilt.
+ */
+void SharedMemoryClient::UpdateRetainedList()
+{
+	const bool rebuild = m_retainedChanged || !m_retainedList;
+	if (!rebuild)
+	{
+		// Hidden objects are not in the lists, there is nothing to patch for them.
+		std::erase_if(m_retainedUpdates, [this](const uint32_t object){ return !(*m_retainedPrimitives)[object]; });
+		if (m_retainedUpdates.empty())
+			return;
+	}
+
+	for (RetainedList &entry : m_retainedLists)
+	{
+		if (rebuild)
+			entry.stale = true;
+		else if (!entry.stale)
+			entry.pending.insert(entry.pending.end(), m_retainedUpdates.begin(), m_retainedUpdates.end());
+	}
+
+	RetainedList &target = AcquireRetainedList();
+	DrawList &    list   = *target.list;
+	const auto &  objects = m_retainedObjects.GetObjects();
+
+	if (target.stale || target.pending.size() > objects.size())
+	{
+		// The primitives only move when objects were created, destroyed, shown or hidden. Otherwise the list
+		// is rebuilt the same way as before, and the published hierarchies keep sharing the current ones.
+		if (rebuild)
+		{
+			m_retainedPrimitives = std::make_shared<std::vector<std::optional<PrimitiveRef>>>();
+			m_retainedPrimitives->reserve(objects.size());
+		}
+
+		list.Clear();
+		for (const RetainedObjectStore::Object &object : objects)
+		{
+			std::optional<PrimitiveRef> primitive;
+			if (!m_hiddenChannels[object.channel])
+			{
+				primitive = list.Add(object.GetTransformed(), object.textId);
+			}
+			if (rebuild)
+			{
+				m_retainedPrimitives->push_back(primitive);
+			}
+		}
+		list.strings = m_strings;
+	}
+	else
+	{
+		for (const uint32_t object : target.pending)
+		{
+			list.Set(*(*m_retainedPrimitives)[object], objects[object].GetTransformed());
+		}
+	}
+	target.pending.clear();
+	target.stale = false;
+
+	// The hierarchy is kept up to date object by object, and tells where each leaf's object ended up in the list.
+	// Leaf payloads are positions in the store, so primitives follows the order of the objects. Publishing shares
+	// the nodes of the tree with the store's until it changes them, and a color change leaves both alone.
+	if (rebuild || m_retainedMoved || !m_retainedHierarchy)
+	{
+		auto hierarchy        = std::make_shared<PrimitiveHierarchy>();
+		hierarchy->tree       = m_retainedObjects.GetHierarchy();
+		hierarchy->primitives = m_retainedPrimitives;
+		m_retainedHierarchy   = std::move(hierarchy);
+	}
+
+	list.patched.clear();
+	list.patchedFrom = 0;
+	if (!rebuild)
+	{
+		list.patchedFrom = m_retainedList->version;
+		for (const uint32_t object : m_retainedUpdates)
+		{
+			list.patched.push_back(*(*m_retainedPrimitives)[object]);
+		}
+	}
+	list.version   = ++m_listVersion;
+	list.hierarchy = m_retainedHierarchy;
+
+	m_retainedList = target.list;
+	m_retainedUpdates.clear();
+	m_retainedChanged = false;
+	m_retainedMoved   = false;
+}
+
+/**
+ * \brief Finds a retained list no snapshot refers to anymore, to build the next one in.
+ */
+SharedMemoryClient::RetainedList &SharedMemoryClient::AcquireRetainedList()
 {
-	std::lock_guard lock(m_drawMutex);
-	return m_drawCommands;
+	for (RetainedList &entry : m_retainedLists)
+	{
+		if (!entry.list)
+		{
+			entry.list  = std::make_shared<DrawList>();
+			entry.stale = true;
+			return entry;
+		}
+		if (entry.list.use_count() == 1)
+		{
+			// The render thread let go of it, make sure it is done reading before the list is written.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return entry;
+		}
+	}
+
+	// There are more lists than snapshots, so this should not happen. If it does, leave one of the lists
+	// to the snapshots still referring to it and start over with a new one.
+	RetainedList &entry = *std::ranges::find_if(m_retainedLists, [this](const RetainedList &other){ return other.list != m_retainedList; });
+	entry.list  = std::make_shared<DrawList>();
+	entry.stale = true;
+	entry.pending.clear();
+	return entry;
 }
 
 void SharedMemoryClient::ClearDrawCommands()
 {
-	std::lock_guard lock(m_drawMutex);
-	m_drawCommands.clear();
+	m_drawCommands.Clear();
+	m_drawCommandsChanged = true;
+
+	if (m_retainedObjects.GetSize() > 0)
+	{
+		m_retainedObjects.Clear();
+		m_retainedChanged = true;
+	}
+
+	// None of the strings are referenced anymore, start over with an empty pool.
+	if (m_strings->GetCount() > 0)
+	{
+		ReplaceStringPool();
+	}
+}
+
+/**
+ * \brief Interns the text of a TEXT command, so repeated labels are stored and measured only once.
+ * \return The id of the text in m_strings.
+ */
+StringPool::StringId SharedMemoryClient::InternText(const TextCommandData &text)
+{
+	StringPool::StringId id = m_strings->Intern(GetTextView(text));
+	if (id == StringPool::INVALID_ID)
+	{
+		RebuildStringPool();
+		id = m_strings->Intern(GetTextView(text));
+	}
+	return id;
+}
+
+/**
+ * \brief Switches to an empty string pool. Snapshots that still refer to the current one keep it alive
+ * until they are recycled, after which a later switch resets and reuses it instead of allocating a new one.
+ */
+void SharedMemoryClient::ReplaceStringPool()
+{
+	std::shared_ptr<StringPool> next;
+
+	const auto reusable = std::ranges::find_if(m_retiredStrings, [](const std::shared_ptr<StringPool> &pool){ return pool.use_count() == 1; });
+	if (reusable != m_retiredStrings.end())
+	{
+		// The render thread let go of it, make sure it is done reading before the pool is written.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		next = std::move(*reusable);
+		m_retiredStrings.erase(reusable);
+		next->Reset();
+	}
+	else
+	{
+		next = std::make_shared<StringPool>(Config::MAX_INTERNED_STRINGS, Config::STRING_POOL_BYTES);
+	}
+
+	if (m_retiredStrings.size() == Config::RETIRED_STRING_POOLS)
+	{
+		m_retiredStrings.erase(m_retiredStrings.begin());
+	}
+	m_retiredStrings.push_back(std::move(m_strings));
+	m_strings = std::move(next);
+}
+
+/**
+ * \brief Replaces a full string pool with one holding only the strings of live commands.
+ */
+void SharedMemoryClient::RebuildStringPool()
+{
+	ReplaceStringPool();
+
+	m_drawCommands.ForEach([this](const DrawCommandPacket &cmd, const DrawCommandStore::SlotIndex slot){
+		if (cmd.type == DrawCommandType::TEXT)
+		{
+			m_textIds[slot] = m_strings->Intern(GetTextView(cmd.text));
+		}
+	});
+
+	for (RetainedObjectStore::Object &object : m_retainedObjects.GetObjects())
+	{
+		if (object.cmd.type == DrawCommandType::TEXT)
+		{
+			object.textId = m_strings->Intern(GetTextView(object.cmd.text));
+		}
+	}
+
+	// Every snapshot refers to the pool, both lists have to be republished against the new one.
+	m_drawCommandsChanged = true;
+	m_retainedChanged     = true;
 }
 
 void SharedMemoryClient::ExpireOldCommands()
 {
-	std::lock_guard lock(m_drawMutex);
-	std::erase_if(m_drawCommands,
-	              [this](const DrawCommandPacket &cmd){
-		              // A command with duration 0 should be rendered for one frame,
-		              // so we check if its end time is 0 but we have a newer time.
-		              if (cmd.drawEndTime <= 0.0f)
-			              return m_currentTime > 0.0f;
-		              return m_currentTime >= cmd.drawEndTime;
-	              });
+	if (m_drawCommands.RemoveExpired(m_currentTime) > 0)
+	{
+		m_drawCommandsChanged = true;
+	}
 }
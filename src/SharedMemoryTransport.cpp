@@ -0,0 +1,40 @@
+#include "SharedMemoryTransport.h"
+
+#include <atomic>
+#include <bit>
+#include <iostream>
+
+bool SharedMemoryTransport::ValidateHeader(SharedMemoryLayout &layout, size_t &capacity)
+{
+	// Acquire pairs with the server's release store of magic, which it writes after the rest of the header.
+	const uint32_t magic = std::atomic_ref(layout.magic).load(std::memory_order_acquire);
+	if (magic != SHARED_MEM_MAGIC)
+	{
+		std::cerr << "Client: Shared memory has bad magic 0x" << std::hex << magic << std::dec
+				<< " (server too old or still initializing).\n";
+		return false;
+	}
+
+	if (layout.version != SHARED_MEM_PROTOCOL_VERSION)
+	{
+		std::cerr << "Client: Protocol version mismatch. Server speaks " << layout.version
+				<< ", we speak " << SHARED_MEM_PROTOCOL_VERSION << ".\n";
+		return false;
+	}
+
+	if (!std::has_single_bit(layout.capacity) || layout.capacity < SHARED_MEM_MIN_BUFFER_SIZE || layout.capacity > SHARED_MEM_MAX_BUFFER_SIZE)
+	{
+		std::cerr << "Client: Invalid buffer capacity " << layout.capacity << ". Must be a power of 2 between "
+				<< SHARED_MEM_MIN_BUFFER_SIZE << " and " << SHARED_MEM_MAX_BUFFER_SIZE << ".\n";
+		return false;
+	}
+
+	if (const uint64_t unknown = layout.features & ~SHARED_MEM_SUPPORTED_FEATURES; unknown != 0)
+	{
+		std::cerr << "Client: Server uses unsupported features 0x" << std::hex << unknown << std::dec << ".\n";
+		return false;
+	}
+
+	capacity = static_cast<size_t>(layout.capacity);
+	return true;
+}
@@ -0,0 +1,225 @@
+#if defined(__linux__)
+
+#include "SharedMemoryTransport.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// POSIX shared memory object + futex on SharedMemoryLayout::signal.
+// The server bumps the signal word after publishing head and then issues a FUTEX_WAKE on it.
+class PosixSharedMemoryTransport final : public SharedMemoryTransport
+{
+public:
+	using SharedMemoryTransport::SharedMemoryTransport;
+
+	~PosixSharedMemoryTransport() override;
+
+	bool Open() override;
+	void Close() override;
+	bool WaitForData(uint32_t timeoutMs) override;
+	void Wake() override;
+
+private:
+	SharedMemoryLayout *MapMirroredView() const;
+
+	int      m_fd         = -1;
+	size_t   m_mappedSize = 0;
+	uint32_t m_lastSignal = 0; // Last value of SharedMemoryLayout::signal we consumed
+};
+
+PosixSharedMemoryTransport::~PosixSharedMemoryTransport()
+{
+	Close();
+}
+
+bool PosixSharedMemoryTransport::Open()
+{
+	// 1. Open the shared memory object.
+	m_fd = shm_open(SHARED_MEM_POSIX_NAME, O_RDWR, 0);
+	if (m_fd < 0)
+	{
+		const int error = errno;
+		std::cerr << "Client: shm_open failed, errno=" << error << " (" << std::strerror(error) << ")";
+		if (error == ENOENT)
+		{
+			std::cerr << ". Is the server running?";
+		}
+		std::cerr << "\n";
+		return false;
+	}
+
+	struct stat info = {};
+	if (fstat(m_fd, &info) != 0 || static_cast<size_t>(info.st_size) < SHARED_MEM_HEADER_SIZE)
+	{
+		std::cerr << "Client: Shared memory object is too small, expected at least " << SHARED_MEM_HEADER_SIZE << " bytes.\n";
+		Close();
+		return false;
+	}
+
+	// 2. Map the control block on its own first to validate the header and learn the buffer size.
+	void *header = mmap(nullptr, SHARED_MEM_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (header == MAP_FAILED)
+	{
+		const int error = errno;
+		std::cerr << "Client: mmap of the header failed, errno=" << error << " (" << std::strerror(error) << ")\n";
+		Close();
+		return false;
+	}
+
+	const bool headerValid = ValidateHeader(*static_cast<SharedMemoryLayout*>(header), m_capacity);
+	munmap(header, SHARED_MEM_HEADER_SIZE);
+
+	if (!headerValid)
+	{
+		Close();
+		return false;
+	}
+
+	if (static_cast<size_t>(info.st_size) < GetSharedMemorySize(m_capacity))
+	{
+		std::cerr << "Client: Shared memory object is too small, expected at least " << GetSharedMemorySize(m_capacity) << " bytes.\n";
+		Close();
+		return false;
+	}
+
+	// 3. Map it, preferably with the buffer mirrored behind itself.
+	if (m_mirrorRequested)
+	{
+		m_pSharedMem = MapMirroredView();
+		if (m_pSharedMem == nullptr)
+		{
+			std::cerr << "Client: Mirrored mapping unavailable, errno=" << errno << ". Falling back to a single view.\n";
+		}
+		else
+		{
+			m_mappedSize = GetSharedMemorySize(m_capacity) + m_capacity;
+			m_mirrored   = true;
+		}
+	}
+
+	if (m_pSharedMem == nullptr)
+	{
+		void *view = mmap(nullptr, GetSharedMemorySize(m_capacity), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if (view == MAP_FAILED)
+		{
+			const int error = errno;
+			std::cerr << "Client: mmap failed, errno=" << error << " (" << std::strerror(error) << ")\n";
+			Close();
+			return false;
+		}
+
+		m_pSharedMem = static_cast<SharedMemoryLayout*>(view);
+		m_mappedSize = GetSharedMemorySize(m_capacity);
+	}
+
+	m_lastSignal = std::atomic_ref(m_pSharedMem->signal).load(std::memory_order_acquire);
+	return true;
+}
+
+void PosixSharedMemoryTransport::Close()
+{
+	if (m_pSharedMem != nullptr)
+	{
+		// A mirrored mapping lives in one reservation, so a single munmap releases both views.
+		munmap(m_pSharedMem, m_mappedSize);
+		m_pSharedMem = nullptr;
+		m_mappedSize = 0;
+	}
+
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+
+	m_capacity = 0;
+	m_mirrored = false;
+}
+
+bool PosixSharedMemoryTransport::WaitForData(const uint32_t timeoutMs)
+{
+	std::atomic_ref signal(m_pSharedMem->signal);
+
+	uint32_t current = signal.load(std::memory_order_acquire);
+	if (current == m_lastSignal)
+	{
+		// Only sleeps if the word still holds the value we last saw, so a wake between the load and the wait is not lost.
+		const timespec timeout = {
+			.tv_sec = static_cast<time_t>(timeoutMs / 1000),
+			.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L,
+		};
+		syscall(SYS_futex, &m_pSharedMem->signal, FUTEX_WAIT, m_lastSignal, &timeout, nullptr, 0);
+
+		current = signal.load(std::memory_order_acquire);
+		if (current == m_lastSignal)
+			return false; // Timeout, spurious wakeup or Wake()
+	}
+
+	m_lastSignal = current;
+	return true;
+}
+
+void PosixSharedMemoryTransport::Wake()
+{
+	if (m_pSharedMem != nullptr)
+	{
+		// Does not touch the signal word, the woken thread sees no new data and re-checks its stop flag.
+		syscall(SYS_futex, &m_pSharedMem->signal, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+	}
+}
+
+/**
+ * \brief Maps the shared memory with a second view of the buffer placed directly behind the first one.
+ *        Any read that runs past the end of the buffer then lands in the mirror and sees the wrapped data,
+ *        so packets can always be read as one contiguous span.
+ * \return The mapped layout, or nullptr if mapping failed.
+ */
+SharedMemoryLayout *PosixSharedMemoryTransport::MapMirroredView() const
+{
+	const size_t viewSize = GetSharedMemorySize(m_capacity);
+
+	// Views can only start on a page, the buffer has to start and end on one to be mapped again by itself.
+	const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	if (SHARED_MEM_HEADER_SIZE % pageSize != 0 || m_capacity % pageSize != 0)
+	{
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	// Reserve address space for [header + buffer][buffer mirror], then map over it with MAP_FIXED.
+	auto *reservation = static_cast<std::byte*>(mmap(nullptr, viewSize + m_capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (reservation == MAP_FAILED)
+		return nullptr;
+
+	// Map the whole layout at the start of the reservation...
+	if (mmap(reservation, viewSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, 0) == MAP_FAILED)
+	{
+		munmap(reservation, viewSize + m_capacity);
+		return nullptr;
+	}
+
+	// ...and only the buffer pages again directly behind it.
+	if (mmap(reservation + viewSize, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, SHARED_MEM_HEADER_SIZE) == MAP_FAILED)
+	{
+		munmap(reservation, viewSize + m_capacity);
+		return nullptr;
+	}
+
+	return reinterpret_cast<SharedMemoryLayout*>(reservation);
+}
+
+std::unique_ptr<SharedMemoryTransport> CreateSharedMemoryTransport(const bool mirrored)
+{
+	return std::make_unique<PosixSharedMemoryTransport>(mirrored);
+}
+
+#endif // __linux__
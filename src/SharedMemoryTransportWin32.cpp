@@ -0,0 +1,267 @@
+#if defined(_WIN32)
+
+#include "SharedMemoryTransport.h"
+
+#include <iostream>
+
+namespace
+{
+	// The placeholder APIs of Windows 10 1803 and later. They are looked up at runtime instead of linking
+	// onecore.lib, so the client still starts on older systems and just falls back to a single view there.
+	using VirtualAlloc2Function  = PVOID (WINAPI *)(HANDLE process, PVOID baseAddress, SIZE_T size, ULONG allocationType,
+	                                                ULONG pageProtection, void *extendedParameters, ULONG parameterCount);
+	using MapViewOfFile3Function = PVOID (WINAPI *)(HANDLE fileMapping, HANDLE process, PVOID baseAddress, ULONG64 offset,
+	                                                SIZE_T viewSize, ULONG allocationType, ULONG pageProtection,
+	                                                void *extendedParameters, ULONG parameterCount);
+}
+
+// Named file mapping + auto-reset event created by the server.
+class Win32SharedMemoryTransport final : public SharedMemoryTransport
+{
+public:
+	using SharedMemoryTransport::SharedMemoryTransport;
+
+	~Win32SharedMemoryTransport() override;
+
+	bool Open() override;
+	void Close() override;
+	bool WaitForData(uint32_t timeoutMs) override;
+	void Wake() override;
+
+private:
+	SharedMemoryLayout *MapMirroredView();
+
+	HANDLE m_hMapFile    = nullptr;
+	HANDLE m_hEvent      = nullptr;
+	void * m_pRingMirror = nullptr; // Second view of the buffer, directly behind the first one
+};
+
+Win32SharedMemoryTransport::~Win32SharedMemoryTransport()
+{
+	Close();
+}
+
+bool Win32SharedMemoryTransport::Open()
+{
+	// 1. Open the event used for signaling.
+	m_hEvent = OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, EVENT_NAME);
+	if (m_hEvent == nullptr)
+	{
+		const DWORD error = GetLastError();
+		std::cerr << "Client: OpenEvent failed, GLE=" << error;
+		switch (error)
+		{
+			case ERROR_FILE_NOT_FOUND:
+				std::cerr << " (Event not found - server may not be running)";
+				break;
+			case ERROR_ACCESS_DENIED:
+				std::cerr << " (Access denied - insufficient permissions)";
+				break;
+			default:
+				break;
+		}
+		std::cerr << ". Is the server running?\n";
+		return false;
+	}
+
+	// 2. Open the file mapping object.
+	m_hMapFile = OpenFileMappingW(
+	                              FILE_MAP_ALL_ACCESS, // Read-only access
+	                              FALSE,               // Do not inherit the name
+	                              SHARED_MEM_NAME      // Name of mapping object
+	                             );
+
+	if (m_hMapFile == nullptr)
+	{
+		const DWORD error = GetLastError();
+		std::cerr << "Client: OpenFileMapping failed, GLE=" << error;
+		switch (error)
+		{
+			case ERROR_FILE_NOT_FOUND:
+				std::cerr << " (Shared memory not found - server may not be running)";
+				break;
+			case ERROR_ACCESS_DENIED:
+				std::cerr << " (Access denied - insufficient permissions)";
+				break;
+			default:
+				break;
+		}
+		std::cerr << "\n";
+		Close();
+		return false;
+	}
+
+	// 3. Map the control block on its own first to validate the header and learn the buffer size.
+	auto *header = static_cast<SharedMemoryLayout*>(MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, SHARED_MEM_HEADER_SIZE));
+	if (header == nullptr)
+	{
+		std::cerr << "Client: MapViewOfFile of the header failed, GLE=" << GetLastError() << "\n";
+		Close();
+		return false;
+	}
+
+	const bool headerValid = ValidateHeader(*header, m_capacity);
+	UnmapViewOfFile(header);
+
+	if (!headerValid)
+	{
+		Close();
+		return false;
+	}
+
+	// 4. Map the view of the file, preferably with the buffer mirrored behind itself.
+	if (m_mirrorRequested)
+	{
+		m_pSharedMem = MapMirroredView();
+		if (m_pSharedMem == nullptr)
+		{
+			std::cerr << "Client: Mirrored mapping unavailable, GLE=" << GetLastError() << ". Falling back to a single view.\n";
+		}
+	}
+
+	if (m_pSharedMem == nullptr)
+	{
+		m_pSharedMem = static_cast<SharedMemoryLayout*>(MapViewOfFile(
+		                                                              m_hMapFile,
+		                                                              FILE_MAP_ALL_ACCESS,
+		                                                              0,
+		                                                              0,
+		                                                              GetSharedMemorySize(m_capacity)
+		                                                             ));
+	}
+
+	if (m_pSharedMem == nullptr)
+	{
+		const DWORD error = GetLastError();
+		std::cerr << "Client: MapViewOfFile failed, GLE=" << error;
+		switch (error)
+		{
+			case ERROR_ACCESS_DENIED:
+				std::cerr << " (Access denied - permission mismatch or insufficient privileges)";
+				break;
+			case ERROR_INVALID_PARAMETER:
+				std::cerr << " (Invalid parameter - size or offset issue)";
+				break;
+			case ERROR_NOT_ENOUGH_MEMORY:
+				std::cerr << " (Not enough memory)";
+				break;
+			default:
+				break;
+		}
+		std::cerr << "\n";
+		Close();
+		return false;
+	}
+
+	m_mirrored = m_pRingMirror != nullptr;
+	return true;
+}
+
+void Win32SharedMemoryTransport::Close()
+{
+	if (m_pRingMirror != nullptr)
+	{
+		UnmapViewOfFile(m_pRingMirror);
+		m_pRingMirror = nullptr;
+	}
+
+	if (m_pSharedMem != nullptr)
+	{
+		UnmapViewOfFile(m_pSharedMem);
+		m_pSharedMem = nullptr;
+	}
+
+	if (m_hMapFile != nullptr)
+	{
+		CloseHandle(m_hMapFile);
+		m_hMapFile = nullptr;
+	}
+
+	if (m_hEvent != nullptr)
+	{
+		CloseHandle(m_hEvent);
+		m_hEvent = nullptr;
+	}
+
+	m_capacity = 0;
+	m_mirrored = false;
+}
+
+bool Win32SharedMemoryTransport::WaitForData(const uint32_t timeoutMs)
+{
+	return WaitForSingleObject(m_hEvent, timeoutMs) == WAIT_OBJECT_0;
+}
+
+void Win32SharedMemoryTransport::Wake()
+{
+	if (m_hEvent != nullptr)
+	{
+		SetEvent(m_hEvent);
+	}
+}
+
+/**
+ * \brief Maps the shared memory with a second view of the buffer placed directly behind the first one.
+ *        Any read that runs past the end of the buffer then lands in the mirror and sees the wrapped data,
+ *        so packets can always be read as one contiguous span.
+ * \return The mapped layout, or nullptr if the placeholder APIs are unavailable or mapping failed.
+ */
+SharedMemoryLayout *Win32SharedMemoryTransport::MapMirroredView()
+{
+	const HMODULE kernelBase = GetModuleHandleW(L"kernelbase.dll");
+	if (kernelBase == nullptr)
+		return nullptr;
+
+	const auto virtualAlloc2  = reinterpret_cast<VirtualAlloc2Function>(GetProcAddress(kernelBase, "VirtualAlloc2"));
+	const auto mapViewOfFile3 = reinterpret_cast<MapViewOfFile3Function>(GetProcAddress(kernelBase, "MapViewOfFile3"));
+	if (virtualAlloc2 == nullptr || mapViewOfFile3 == nullptr)
+		return nullptr;
+
+	const size_t viewSize = GetSharedMemorySize(m_capacity);
+
+	// Reserve address space for [header + buffer][buffer mirror] and split it into two placeholders.
+	auto *placeholder = static_cast<std::byte*>(virtualAlloc2(
+	                                                         nullptr,
+	                                                         nullptr,
+	                                                         viewSize + m_capacity,
+	                                                         MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+	                                                         PAGE_NOACCESS,
+	                                                         nullptr,
+	                                                         0
+	                                                        ));
+	if (placeholder == nullptr)
+		return nullptr;
+
+	if (!VirtualFree(placeholder, viewSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER))
+	{
+		VirtualFree(placeholder, 0, MEM_RELEASE);
+		return nullptr;
+	}
+
+	// Map the whole layout into the first placeholder...
+	void *view = mapViewOfFile3(m_hMapFile, GetCurrentProcess(), placeholder, 0, viewSize, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+	if (view == nullptr)
+	{
+		VirtualFree(placeholder, 0, MEM_RELEASE);
+		VirtualFree(placeholder + viewSize, 0, MEM_RELEASE);
+		return nullptr;
+	}
+
+	// ...and only the buffer pages again into the second one.
+	m_pRingMirror = mapViewOfFile3(m_hMapFile, GetCurrentProcess(), placeholder + viewSize, SHARED_MEM_HEADER_SIZE, m_capacity, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+	if (m_pRingMirror == nullptr)
+	{
+		UnmapViewOfFile(view);
+		VirtualFree(placeholder + viewSize, 0, MEM_RELEASE);
+		return nullptr;
+	}
+
+	return static_cast<SharedMemoryLayout*>(view);
+}
+
+std::unique_ptr<SharedMemoryTransport> CreateSharedMemoryTransport(const bool mirrored)
+{
+	return std::make_unique<Win32SharedMemoryTransport>(mirrored);
+}
+
+#endif // _WIN32
@@ -0,0 +1,48 @@
+#include "StringPool.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	std::atomic<uint64_t> g_nextPoolGeneration = 1;
+}
+
+StringPool::StringPool(const size_t maxStrings, const size_t maxBytes)
+	: m_offsets(std::make_unique_for_overwrite<uint32_t[]>(maxStrings)),
+	  m_characters(std::make_unique_for_overwrite<char[]>(maxBytes)),
+	  m_maxStrings(maxStrings),
+	  m_maxBytes(maxBytes),
+	  m_generation(g_nextPoolGeneration.fetch_add(1, std::memory_order_relaxed))
+{
+	m_lookup.reserve(maxStrings);
+}
+
+void StringPool::Reset()
+{
+	m_lookup.clear();
+	m_count      = 0;
+	m_usedBytes  = 0;
+	m_generation = g_nextPoolGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+StringPool::StringId StringPool::Intern(const std::string_view text)
+{
+	if (const auto it = m_lookup.find(text); it != m_lookup.end())
+		return it->second;
+
+	if (m_count == m_maxStrings || m_maxBytes - m_usedBytes < text.size() + 1)
+		return INVALID_ID;
+
+	char *dest = m_characters.get() + m_usedBytes;
+	memcpy(dest, text.data(), text.size());
+	dest[text.size()] = '\0';
+
+	const auto id = static_cast<StringId>(m_count);
+	m_offsets[id] = static_cast<uint32_t>(m_usedBytes);
+	m_lookup.emplace(std::string_view(dest, text.size()), id);
+
+	m_count++;
+	m_usedBytes += text.size() + 1;
+	return id;
+}
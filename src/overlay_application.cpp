@@ -53,7 +53,7 @@ bool OverlayApplication::Initialize()
 	m_memoryClient = std::make_unique<SharedMemoryClient>();
 	m_running      = true;
 
-	if (!m_memoryClient->Start(m_running, m_camera))
+	if (!m_memoryClient->Start(m_running))
 	{
 		return false;
 	}
@@ -85,17 +85,25 @@ void OverlayApplication::MainLoop()
 {
 	while (!OverlayRenderer::ShouldClose() && m_running)
 	{
-		// Update camera
-		rlFPCameraUpdate(&m_camera);
-
-		// Get draw commands from shared memory client
-		std::vector<DrawCommandPacket> drawCommands;
-
+		// Move the camera to where the game view is now, between the world updates
 		if (m_memoryClient)
 		{
-			drawCommands = m_memoryClient->GetDrawCommands();
+			// Otherwise the camera stays where it was last frame.
+			if (CameraState cameraState; m_memoryClient->GetCameraState(cameraState) && cameraState.IsValid())
+			{
+				const CameraPose pose = cameraState.GetPose(CameraState::Clock::now(), Config::CAMERA_EXTRAPOLATE);
+				rlFPCameraSetPosition(&m_camera, pose.position);
+				m_camera.ViewAngles = pose.viewAngles;
+			}
 		}
 
+		// Update camera
+		rlFPCameraUpdate(&m_camera);
+
+		// Get the latest draw commands snapshot from shared memory client
+		static const DrawSnapshot noCommands;
+		const auto &drawCommands = m_memoryClient ? m_memoryClient->GetDrawCommands() : noCommands;
+
 		// Render frame
 		m_renderer->BeginFrame();
 		m_renderer->RenderCommands(drawCommands, m_camera);
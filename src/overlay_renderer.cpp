@@ -1,6 +1,47 @@
 #include "overlay_renderer.h"
 #include <iostream>
+#include <optional>
+#include "BoundingVolumeHierarchy.h"
 #include "config.h"
+#include "Raylib/raymath.h"
+#include "Raylib/rlgl.h"
+
+namespace
+{
+	// Frustum of the projection rlFPCameraBeginMode3D sets up for the camera.
+	Frustum GetCameraFrustum(const rlFPCamera &camera, const float aspect)
+	{
+		// The same projection SetupCamera in rlFPSCamera.cpp loads.
+		const double top        = RL_CULL_DISTANCE_NEAR * tan(camera.ViewCamera.fovy * 0.5 * DEG2RAD);
+		const double right      = top * aspect;
+		const Matrix projection = MatrixFrustum(-right, right, -top, top, camera.NearPlane, camera.FarPlane);
+		const Matrix view       = MatrixLookAt(camera.ViewCamera.position, camera.ViewCamera.target, camera.ViewCamera.up);
+		const Matrix m          = MatrixMultiply(view, projection);
+
+		// Gribb/Hartmann: each plane is the w row of the view-projection plus or minus another row.
+		const Vector4 rowX = {m.m0, m.m4, m.m8, m.m12};
+		const Vector4 rowY = {m.m1, m.m5, m.m9, m.m13};
+		const Vector4 rowZ = {m.m2, m.m6, m.m10, m.m14};
+		const Vector4 rowW = {m.m3, m.m7, m.m11, m.m15};
+
+		Frustum frustum = {{
+			Vector4Add(rowW, rowX),      // Left
+			Vector4Subtract(rowW, rowX), // Right
+			Vector4Add(rowW, rowY),      // Bottom
+			Vector4Subtract(rowW, rowY), // Top
+			Vector4Add(rowW, rowZ),      // Near
+			Vector4Subtract(rowW, rowZ), // Far
+		}};
+
+		// Unit normals, so plane distances compare against radii.
+		for (Vector4 &plane : frustum.planes)
+		{
+			const float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			plane              = Vector4Scale(plane, 1.0f / length);
+		}
+		return frustum;
+	}
+}
 
 OverlayRenderer::OverlayRenderer() : m_initialized(false) { }
 
@@ -32,6 +73,16 @@ bool OverlayRenderer::Initialize(const int width, const int height, const int x,
 	SetWindowPosition(x, y);
 	SetTargetFPS(Config::TARGET_FPS);
 
+	m_lineBatcher     = std::make_unique<LineBatcher>();
+	m_instanceBatcher = std::make_unique<InstanceBatcher>();
+	if (!m_lineBatcher->IsValid() || !m_instanceBatcher->IsValid())
+	{
+		m_lineBatcher.reset();
+		m_instanceBatcher.reset();
+		CloseWindow();
+		return false;
+	}
+
 	m_initialized = true;
 	return true;
 }
@@ -40,6 +91,8 @@ void OverlayRenderer::Shutdown()
 {
 	if (m_initialized)
 	{
+		m_lineBatcher.reset();
+		m_instanceBatcher.reset();
 		CloseWindow();
 		m_initialized = false;
 	}
@@ -63,64 +116,39 @@ void OverlayRenderer::EndFrame() const
 	EndDrawing();
 }
 
-void OverlayRenderer::RenderCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera) const
+void OverlayRenderer::RenderCommands(const DrawSnapshot &snapshot, const rlFPCamera &camera)
 {
 	if (!m_initialized)
 		return;
 
-	Render3DCommands(commands, camera);
-	Render2DCommands(commands, camera);
-}
-
-void OverlayRenderer::Render3DCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera)
-{
 	rlFPCameraBeginMode3D(&camera);
 
-	for (const auto &cmd : commands)
+	const DrawList *                 lists[] = {snapshot.retained.get(), &snapshot.commands};
+	const std::span<const DrawList *const> drawLists = snapshot.retained ? std::span(lists) : std::span(lists).subspan(1);
+
+	// The batchers keep what they uploaded of the lists and only draw the visible part of it.
+	std::span<const Visibility> visibility;
+	if constexpr (Config::FRUSTUM_CULLING)
 	{
-		switch (cmd.type)
-		{
-			case DrawCommandType::LINE:
-			{
-				auto [start, end] = cmd.line;
-				DrawLine3D(start.ToRayLib(), end.ToRayLib(), cmd.color);
-				break;
-			}
-			case DrawCommandType::TRIANGLE:
-			{
-				auto [p1, p2, p3] = cmd.triangle;
-				DrawTriangle3D(p1.ToRayLib(), p2.ToRayLib(), p3.ToRayLib(), cmd.color);
-				break;
-			}
-			case DrawCommandType::SPHERE:
-			{
-				auto [center, radius] = cmd.sphere;
-				DrawSphereWires(center.ToRayLib(), radius, Config::DEBUG_CYLINDER_SLICES, Config::DEBUG_CYLINDER_SLICES, cmd.color);
-				break;
-			}
-			case DrawCommandType::CIRCLE:
-			{
-				auto [center, xAxis, yAxis, radius] = cmd.circle;
-				DrawCircle3D(center.ToRayLib(), radius, xAxis.ToRayLib(), yAxis.ToRayLib().y, cmd.color);
-				break;
-			}
-			case DrawCommandType::BBOX:
-			{
-				auto [mins, maxs] = cmd.box;
-				DrawBoundingBox({mins.ToRayLib(), maxs.ToRayLib()}, cmd.color);
-				break;
-			}
-			case DrawCommandType::TEXT:
-			{
-				// Handled in Render2DCommands
-				break;
-			}
-			default:  // NOLINT(clang-diagnostic-covered-switch-default)
-			{
-				std::cout << "Uknown cmd type : " << static_cast<int>(cmd.type) << '\n';
-				break;
-			}
-		}
+		const float aspect = static_cast<float>(GetScreenWidth()) / static_cast<float>(GetScreenHeight());
+		visibility         = m_frustumCuller.Cull(drawLists, GetCameraFrustum(camera, aspect));
+	}
+
+	// Lines of both lists go out in a single draw call, and each instanced shape in one more.
+	m_lineBatcher->Update(drawLists, visibility);
+	m_lineBatcher->Draw();
+	m_instanceBatcher->Update(drawLists, visibility);
+	m_instanceBatcher->Draw();
+
+	for (size_t i = 0; i < drawLists.size(); i++)
+	{
+		Render3DCommands(*drawLists[i], visibility.empty() ? nullptr : &visibility[i]);
+	}
+
+	if constexpr (Config::HIGHLIGHT_PICKED)
+	{
+		if (snapshot.retained)
+			RenderPickedPrimitive(*snapshot.retained, camera);
 	}
 
 	// Draw some debug geometry
@@ -132,48 +160,160 @@ void OverlayRenderer::Render3DCommands(const std::vector<DrawCommandPacket> &com
 	//             GREEN);
 
 	rlFPCameraEndMode3D();
+
+	PruneTextWidths(snapshot);
+	if (snapshot.retained)
+	{
+		Render2DCommands(*snapshot.retained, camera);
+	}
+	Render2DCommands(snapshot.commands, camera);
+
+	if constexpr (Config::FRUSTUM_CULLING && Config::SHOW_CULL_STATS)
+	{
+		RenderCullStats();
+	}
 }
 
-void OverlayRenderer::Render2DCommands(const std::vector<DrawCommandPacket> &commands, const rlFPCamera &camera)
+/**
+ * \brief Draws the 3D commands of a list that are not batched, which leaves the triangles.
+ * \param visibility The triangles of the list to draw, or nullptr for all of them.
+ */
+void OverlayRenderer::Render3DCommands(const DrawList &commands, const Visibility *visibility)
 {
-	for (const auto &cmd : commands)
+	const auto &triangles    = commands.triangles;
+	const auto  drawTriangle = [&triangles](const size_t i)
+	{
+		DrawTriangle3D(triangles.points[i * 3], triangles.points[i * 3 + 1], triangles.points[i * 3 + 2], triangles.colors[i]);
+	};
+
+	if (visibility)
+	{
+		for (const uint32_t i : visibility->Get(DrawCommandType::TRIANGLE))
+		{
+			drawTriangle(i);
+		}
+	}
+	else
 	{
-		if (cmd.type == DrawCommandType::TEXT)
+		for (size_t i = 0; i < triangles.GetCount(); i++)
 		{
-			const int text_width = (MeasureText(cmd.text.text, Config::DEBUG_TEXT_SIZE) / 2);
-
-			if (cmd.text.onscreen)
-			{
-				DrawText(cmd.text.text,
-				         static_cast<int>(cmd.text.position.x) - text_width,
-				         static_cast<int>(cmd.text.position.y),
-				         Config::DEBUG_TEXT_SIZE,
-				         cmd.color);
-			}
-			else
-			{
-				const Vector2 screenPos = GetWorldToScreen(cmd.text.position.ToRayLib(), camera.ViewCamera);
-
-				const bool onScreen = (screenPos.x >= 0) && (screenPos.x < static_cast<float>(GetScreenWidth())) &&
-				                      (screenPos.y >= 0) && (screenPos.y < static_cast<float>(GetScreenHeight()));
-
-				const Vector3 camForward = Vector3Subtract(camera.ViewCamera.target, camera.ViewCamera.position);
-				const Vector3 toPoint    = Vector3Subtract(cmd.text.position.ToRayLib(), camera.ViewCamera.position);
-				const bool    inFront    = Vector3DotProduct(camForward, toPoint) > 0;
-
-				if (!onScreen || !inFront)
-					continue;
-
-				DrawText(cmd.text.text,
-				         static_cast<int>(screenPos.x) - text_width,
-				         static_cast<int>(screenPos.y),
-				         Config::DEBUG_TEXT_SIZE,
-				         cmd.color);
-			}
+			drawTriangle(i);
 		}
 	}
 }
 
+/**
+ * \brief Outlines the bounds of the retained primitive under the crosshair, found through the hierarchy of the list.
+ */
+void OverlayRenderer::RenderPickedPrimitive(const DrawList &retained, const rlFPCamera &camera)
+{
+	if (!retained.hierarchy)
+		return;
+
+	const PrimitiveHierarchy &hierarchy = *retained.hierarchy;
+	if (const std::optional<PrimitiveHierarchy::Hit> hit = hierarchy.Raycast(retained, rlFPCameraGetViewRay(&camera)))
+	{
+		DrawBoundingBox(hierarchy.tree.GetBox(hit->leaf), YELLOW);
+	}
+}
+
+void OverlayRenderer::Render2DCommands(const DrawList &commands, const rlFPCamera &camera)
+{
+	if (!commands.strings)
+		return;
+
+	const auto &screenTexts = commands.screenTexts;
+	for (size_t i = 0; i < screenTexts.GetCount(); i++)
+	{
+		const StringPool::StringId id         = screenTexts.stringIds[i];
+		const int                  text_width = (MeasureTextCached(commands, id, Config::DEBUG_TEXT_SIZE) / 2);
+
+		DrawText(commands.GetText(id),
+		         static_cast<int>(screenTexts.positions[i].x) - text_width,
+		         static_cast<int>(screenTexts.positions[i].y),
+		         Config::DEBUG_TEXT_SIZE,
+		         screenTexts.colors[i]);
+	}
+
+	// Project every anchor in one pass, keeping only those in front of the camera and on screen.
+	const auto           &worldTexts = commands.worldTexts;
+	const ScreenProjector projector(camera.ViewCamera, GetScreenWidth(), GetScreenHeight());
+	projector.Project(worldTexts.positions, m_projectedTexts);
+
+	for (size_t visible = 0; visible < m_projectedTexts.GetCount(); visible++)
+	{
+		const uint32_t i         = m_projectedTexts.indices[visible];
+		const Vector2  screenPos = m_projectedTexts.positions[visible];
+
+		const StringPool::StringId id         = worldTexts.stringIds[i];
+		const int                  text_width = (MeasureTextCached(commands, id, Config::DEBUG_TEXT_SIZE) / 2);
+
+		DrawText(commands.GetText(id),
+		         static_cast<int>(screenPos.x) - text_width,
+		         static_cast<int>(screenPos.y),
+		         Config::DEBUG_TEXT_SIZE,
+		         worldTexts.colors[i]);
+	}
+}
+
+/**
+ * \brief MeasureText for an interned string, measured once per string and font size.
+ * \param commands The snapshot whose string pool the id refers to.
+ * \param id The interned string.
+ * \param fontSize The font size to measure at.
+ * \return The width of the text in pixels.
+ */
+int OverlayRenderer::MeasureTextCached(const DrawList &commands, const StringPool::StringId id, const int fontSize)
+{
+	const TextWidthKey key = {commands.strings->GetGeneration(), id, fontSize};
+
+	const auto [it, inserted] = m_textWidths.try_emplace(key, 0);
+	if (inserted)
+	{
+		it->second = MeasureText(commands.GetText(id), fontSize);
+	}
+	return it->second;
+}
+
+/**
+ * \brief Drops the measured widths of string pools the snapshot no longer uses. Does nothing as long as
+ * the pools stay the same, so widths are kept across frames even when the two lists use different pools.
+ */
+void OverlayRenderer::PruneTextWidths(const DrawSnapshot &snapshot)
+{
+	const auto getGeneration = [](const DrawList *list){ return list && list->strings ? list->strings->GetGeneration() : 0; };
+
+	const std::array generations = {getGeneration(snapshot.retained.get()), getGeneration(&snapshot.commands)};
+	if (generations == m_textWidthsGenerations)
+		return;
+
+	std::erase_if(m_textWidths, [&generations](const auto &entry)
+	{
+		return entry.first.generation != generations[0] && entry.first.generation != generations[1];
+	});
+	m_textWidthsGenerations = generations;
+}
+
+size_t OverlayRenderer::TextWidthKeyHash::operator()(const TextWidthKey &key) const
+{
+	// Generations and ids are both small counters, spread them over the whole word before mixing them.
+	const uint64_t bits = key.generation * 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(key.id) << 16 | static_cast<uint16_t>(key.fontSize));
+	return std::hash<uint64_t>{}(bits);
+}
+
+void OverlayRenderer::RenderCullStats() const
+{
+	static constexpr const char *TYPE_NAMES[] = {"Lines", "Triangles", "Spheres", "Circles", "Boxes"};
+	static_assert(std::size(TYPE_NAMES) == std::tuple_size_v<decltype(CullStats::visible)>);
+
+	const CullStats &stats = m_frustumCuller.GetStats();
+	for (size_t type = 0; type < std::size(TYPE_NAMES); type++)
+	{
+		DrawText(TextFormat("%s: %zu visible, %zu culled", TYPE_NAMES[type], stats.visible[type], stats.culled[type]),
+		         10, 10 + static_cast<int>(type) * (Config::DEBUG_TEXT_SIZE + 2), Config::DEBUG_TEXT_SIZE, LIGHTGRAY);
+	}
+}
+
 void OverlayRenderer::RenderDebugInfo()
 {
 	DrawText("Debug Overlay Active", 190, 200, Config::DEBUG_TEXT_SIZE, LIGHTGRAY);
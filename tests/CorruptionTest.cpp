@@ -0,0 +1,120 @@
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "SharedMemoryClient.h"
+#include "TestSupport.h"
+
+namespace
+{
+	enum class Corruption : uint8_t
+	{
+		FLIPPED_DATA,   // A byte of the data flipped, only the checksum catches it
+		FLIPPED_HEADER, // A byte of the framed header flipped
+		TRUNCATED,      // The frame ends before the size in its header says
+		GARBAGE,        // Random bytes between two frames, with sync words mixed in
+		COUNT,
+	};
+
+	std::vector<std::byte> MakeFrame(const float x)
+	{
+		const DrawCommandPacket packet(DrawCommandType::LINE, RED, 100.0f, LineCommandData({x, 0, 0}, {x, 1, 1}));
+		const FramedPacketHeader header = {SHARED_MEM_SYNC_WORD, PacketType::DRAW_COMMAND, sizeof(packet),
+		                                   ComputePacketChecksum(PacketType::DRAW_COMMAND, sizeof(packet), reinterpret_cast<const std::byte*>(&packet))};
+
+		std::vector<std::byte> frame(sizeof(header) + sizeof(packet));
+		memcpy(frame.data(), &header, sizeof(header));
+		memcpy(frame.data() + sizeof(header), &packet, sizeof(packet));
+		return frame;
+	}
+
+	// Sends a valid packet after every corrupted one and checks the client keeps exactly the valid ones, in order,
+	// so none of them got lost while it was resynchronizing.
+	void TestResync()
+	{
+		TestServer server(SHARED_MEM_MIN_BUFFER_SIZE);
+
+		std::atomic<bool>  running = true;
+		SharedMemoryClient client;
+		CHECK(client.Start(running));
+
+		std::mt19937       random(42);
+		std::vector<float> expected;
+		size_t             corrupted       = 0;
+		size_t             flippedData     = 0;
+		float              next            = 0.0f;
+		constexpr int      CORRUPTED_COUNT = 4000;
+		for (int i = 0; i < CORRUPTED_COUNT; i++)
+		{
+			std::vector<std::byte> frame = MakeFrame(-1.0f - static_cast<float>(i)); // Never expected
+			switch (static_cast<Corruption>(i % static_cast<int>(Corruption::COUNT)))
+			{
+				case Corruption::FLIPPED_DATA:
+					frame[sizeof(FramedPacketHeader) + random() % (frame.size() - sizeof(FramedPacketHeader))] ^= std::byte{1} << random() % 8;
+					flippedData++;
+					break;
+				case Corruption::FLIPPED_HEADER:
+					frame[random() % sizeof(FramedPacketHeader)] ^= std::byte{1} << random() % 8;
+					break;
+				case Corruption::TRUNCATED:
+					frame.resize(1 + random() % (frame.size() - 1));
+					break;
+				case Corruption::GARBAGE:
+				default:  // NOLINT(clang-diagnostic-covered-switch-default)
+					frame.resize(1 + random() % 200);
+					for (std::byte &byte : frame)
+					{
+						byte = static_cast<std::byte>(random());
+					}
+					for (size_t j = 0; j + sizeof(SHARED_MEM_SYNC_WORD) <= frame.size(); j += 1 + random() % 40)
+					{
+						memcpy(frame.data() + j, &SHARED_MEM_SYNC_WORD, sizeof(SHARED_MEM_SYNC_WORD));
+					}
+					break;
+			}
+			server.SendRaw({frame.data(), frame.size()});
+			corrupted++;
+
+			// Sometimes published along with the corruption, sometimes only after the client went through it alone.
+			if (random() % 2 == 0)
+			{
+				server.Signal();
+			}
+
+			const std::vector<std::byte> valid = MakeFrame(next);
+			server.SendRaw({valid.data(), valid.size()});
+			expected.push_back(next);
+			next += 1.0f;
+
+			if (i % 8 == 0)
+			{
+				server.Signal();
+			}
+		}
+		CHECK(server.WaitUntilDrained());
+		CHECK(WaitFor([&] { return client.GetDrawCommands().commands.lines.GetCount() >= expected.size(); }));
+
+		const DrawList &list = client.GetDrawCommands().commands;
+		CHECK(list.lines.GetCount() == expected.size());
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			CHECK(list.lines.points[i * 2].z == expected[i]); // Vector::x is raylib's z
+		}
+
+		// Each corruption is dropped on its own; a garbage sync word or a header that is still in one piece may cost
+		// more than one resync, but never fewer. Flipped data always fails the checksum.
+		const IngestStats stats = client.GetStats();
+		CHECK(stats.resyncs >= corrupted);
+		CHECK(stats.checksumFailures >= flippedData);
+		CHECK(stats.checksumFailures <= stats.resyncs);
+		CHECK(stats.bytesSkipped > 0);
+
+		client.Stop();
+	}
+}
+
+int main()
+{
+	TestResync();
+	return EXIT_SUCCESS;
+}
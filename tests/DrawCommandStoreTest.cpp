@@ -0,0 +1,354 @@
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "DrawCommandStore.h"
+#include "TestSupport.h"
+
+namespace
+{
+	// A line tagged with id, which is distinct per id and so never deduplicated against another one.
+	DrawCommandPacket MakeLine(const int id, const float drawEndTime)
+	{
+		const auto x = static_cast<float>(id);
+		return {DrawCommandType::LINE, RED, drawEndTime, LineCommandData({x, 0, 0}, {x, 1, 1})};
+	}
+
+	// The ids of the stored lines, oldest first.
+	std::vector<int> GetIds(const DrawCommandStore &store)
+	{
+		std::vector<int> ids;
+		store.ForEach([&](const DrawCommandPacket &cmd, DrawCommandStore::SlotIndex)
+		{
+			ids.push_back(static_cast<int>(cmd.line.start.x));
+		});
+		return ids;
+	}
+
+	std::vector<int> MakeRange(const int first, const int last)
+	{
+		std::vector<int> ids;
+		for (int id = first; id < last; id++)
+		{
+			ids.push_back(id);
+		}
+		return ids;
+	}
+
+	// Filling the store past its capacity evicts the oldest commands first, and a re-sent command counts as new again.
+	void TestEvictionOrder(const bool deduplicate)
+	{
+		constexpr int CAPACITY = static_cast<int>(Config::MAX_DRAW_COMMANDS);
+		constexpr int EXTRA    = 100;
+
+		DrawCommandStore store(Config::MAX_DRAW_COMMANDS, deduplicate);
+		for (int id = 0; id < CAPACITY; id++)
+		{
+			store.Insert(0, MakeLine(id, 10.0f));
+		}
+		CHECK(store.GetSize() == Config::MAX_DRAW_COMMANDS);
+		CHECK(GetIds(store) == MakeRange(0, CAPACITY));
+
+		for (int id = CAPACITY; id < CAPACITY + EXTRA; id++)
+		{
+			store.Insert(0, MakeLine(id, 10.0f));
+		}
+		CHECK(store.GetSize() == Config::MAX_DRAW_COMMANDS);
+		CHECK(GetIds(store) == MakeRange(EXTRA, CAPACITY + EXTRA));
+
+		if (!deduplicate)
+			return;
+
+		// The oldest command is sent again, so it becomes the newest and the one after it goes first.
+		store.Insert(0, MakeLine(EXTRA, 10.0f));
+		store.Insert(0, MakeLine(CAPACITY + EXTRA, 10.0f));
+
+		std::vector<int> expected = MakeRange(EXTRA + 2, CAPACITY + EXTRA);
+		expected.push_back(EXTRA);
+		expected.push_back(CAPACITY + EXTRA);
+		CHECK(GetIds(store) == expected);
+	}
+
+	// A removed command's slot is the next one handed out, and the command in it is linked as the newest.
+	void TestSlotReuse()
+	{
+		DrawCommandStore store(8, false);
+		const DrawCommandStore::SlotIndex first  = store.Insert(0, MakeLine(0, 10.0f));
+		const DrawCommandStore::SlotIndex second = store.Insert(0, MakeLine(1, 10.0f));
+		const DrawCommandStore::SlotIndex third  = store.Insert(0, MakeLine(2, 10.0f));
+		CHECK(first != second && second != third && first != third);
+
+		store.Remove(second);
+		CHECK(store.GetSize() == 2);
+		CHECK((GetIds(store) == std::vector{0, 2}));
+
+		CHECK(store.Insert(0, MakeLine(3, 10.0f)) == second);
+		CHECK(store.Get(second).line.start.x == 3.0f);
+		CHECK((GetIds(store) == std::vector{0, 2, 3}));
+
+		// Several removed slots come back last removed first.
+		store.Remove(first);
+		store.Remove(third);
+		CHECK(store.Insert(0, MakeLine(4, 10.0f)) == third);
+		CHECK(store.Insert(0, MakeLine(5, 10.0f)) == first);
+		CHECK((GetIds(store) == std::vector{3, 4, 5}));
+	}
+
+	// A one-frame command survives until the next expiry pass with a time, as the client runs one per world update
+	// before it publishes, so it is in exactly one published list. One added after a pass waits for the next one.
+	void TestTransientLifetime()
+	{
+		DrawCommandStore store(8, true);
+		store.Insert(0, MakeLine(0, 0.0f));
+		store.Insert(0, MakeLine(1, 5.0f));
+
+		// Without a time yet, nothing is known to be newer than the frame the command was sent for.
+		CHECK(store.RemoveExpired(0.0f) == 0);
+		CHECK((GetIds(store) == std::vector{0, 1}));
+
+		CHECK(store.RemoveExpired(1.0f) == 1);
+		CHECK((GetIds(store) == std::vector{1}));
+
+		store.Insert(0, MakeLine(2, 0.0f));
+		CHECK((GetIds(store) == std::vector{1, 2}));
+		CHECK(store.RemoveExpired(1.0f) == 1);
+		CHECK((GetIds(store) == std::vector{1}));
+
+		// One-frame commands are never deduplicated, each of them is shown once.
+		store.Insert(0, MakeLine(3, 0.0f));
+		store.Insert(0, MakeLine(3, 0.0f));
+		CHECK(store.GetSize() == 3);
+		CHECK(store.RemoveExpired(2.0f) == 2);
+		CHECK((GetIds(store) == std::vector{1}));
+	}
+
+	// Entries left in the heap by commands that were extended, removed or evicted do not remove what is in the slot now.
+	void TestStaleExpiryEntries()
+	{
+		// Extended: the entry for the first end time goes stale.
+		{
+			DrawCommandStore                  store(8, true);
+			const DrawCommandStore::SlotIndex slot = store.Insert(0, MakeLine(0, 5.0f));
+			CHECK(store.Insert(0, MakeLine(0, 9.0f)) == slot);
+			CHECK(store.Get(slot).drawEndTime == 9.0f);
+
+			// Sending it again with an earlier end time does not shorten it.
+			CHECK(store.Insert(0, MakeLine(0, 7.0f)) == slot);
+			CHECK(store.Get(slot).drawEndTime == 9.0f);
+
+			CHECK(store.RemoveExpired(5.0f) == 0);
+			CHECK(store.RemoveExpired(8.9f) == 0);
+			CHECK((GetIds(store) == std::vector{0}));
+			CHECK(store.RemoveExpired(9.0f) == 1);
+			CHECK(store.IsEmpty());
+		}
+
+		// Removed, and the slot reused by a command that ends later.
+		{
+			DrawCommandStore                  store(8, false);
+			const DrawCommandStore::SlotIndex slot = store.Insert(0, MakeLine(0, 5.0f));
+			store.Remove(slot);
+			CHECK(store.Insert(0, MakeLine(1, 20.0f)) == slot);
+
+			CHECK(store.RemoveExpired(5.0f) == 0);
+			CHECK((GetIds(store) == std::vector{1}));
+			CHECK(store.RemoveExpired(20.0f) == 1);
+			CHECK(store.IsEmpty());
+		}
+
+		// Removed, and the slot reused by a command with the same end time: only the slot generation tells
+		// the two entries apart, and the command is removed once.
+		{
+			DrawCommandStore                  store(8, false);
+			const DrawCommandStore::SlotIndex slot = store.Insert(0, MakeLine(0, 5.0f));
+			store.Remove(slot);
+			CHECK(store.Insert(0, MakeLine(1, 5.0f)) == slot);
+			store.Insert(0, MakeLine(2, 5.0f));
+
+			CHECK(store.RemoveExpired(5.0f) == 2);
+			CHECK(store.IsEmpty());
+			CHECK(store.GetSize() == 0);
+		}
+
+		// Evicted by a later insert, which takes over its slot.
+		{
+			DrawCommandStore store(2, false);
+			store.Insert(0, MakeLine(0, 5.0f));
+			store.Insert(0, MakeLine(1, 30.0f));
+			store.Insert(0, MakeLine(2, 30.0f));
+			CHECK((GetIds(store) == std::vector{1, 2}));
+
+			CHECK(store.RemoveExpired(5.0f) == 0);
+			CHECK((GetIds(store) == std::vector{1, 2}));
+			CHECK(store.RemoveExpired(30.0f) == 2);
+		}
+	}
+
+	// Once stale entries fill the heap up to twice the capacity, the next insert drops them and keeps the live ones.
+	void TestExpiryHeapCompaction()
+	{
+		constexpr size_t CAPACITY = 4;
+
+		DrawCommandStore store(CAPACITY, true);
+		for (int id = 0; id < static_cast<int>(CAPACITY); id++)
+		{
+			store.Insert(0, MakeLine(id, 100.0f + static_cast<float>(id)));
+		}
+		CHECK(store.GetExpiryEntryCount() == CAPACITY);
+
+		// Each extension leaves the entry before it stale.
+		float endTime = 200.0f;
+		while (store.GetExpiryEntryCount() < CAPACITY * 2)
+		{
+			store.Insert(0, MakeLine(0, endTime++));
+		}
+		CHECK(store.GetExpiryEntryCount() == CAPACITY * 2);
+
+		// Every entry of line 0 is stale by then, its new end time is only pushed after the compaction.
+		// The other three commands keep their one entry each, so that and the new one are left.
+		store.Insert(0, MakeLine(0, endTime));
+		CHECK(store.GetExpiryEntryCount() == CAPACITY);
+		CHECK(store.GetSize() == CAPACITY);
+
+		// The live entries still expire every command once, at its latest end time.
+		CHECK(store.RemoveExpired(103.0f) == CAPACITY - 1);
+		CHECK((GetIds(store) == std::vector{0}));
+		CHECK(store.RemoveExpired(endTime - 0.5f) == 0);
+		CHECK(store.RemoveExpired(endTime) == 1);
+		CHECK(store.IsEmpty());
+	}
+
+	// Two different lines whose content hashes are equal. CRC32C never maps two values of one 32-bit field to the same
+	// hash, so the lines differ in two coordinates, drawn at random until a pair collides.
+	std::pair<DrawCommandPacket, DrawCommandPacket> FindHashCollision()
+	{
+		const auto makeLine = [](const uint32_t x, const uint32_t y)
+		{
+			return DrawCommandPacket(DrawCommandType::LINE, RED, 10.0f, LineCommandData({static_cast<float>(x), static_cast<float>(y), 0}, {0, 0, 0}));
+		};
+
+		std::mt19937                                                random(1);
+		std::uniform_int_distribution<uint32_t>                     coordinate(0, 1 << 20);
+		std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> lines;
+		while (true)
+		{
+			const uint32_t x = coordinate(random);
+			const uint32_t y = coordinate(random);
+			const auto [it, added] = lines.emplace(DrawCommandStore::HashContent(0, makeLine(x, y)), std::pair(x, y));
+			if (!added && it->second != std::pair(x, y))
+				return {makeLine(it->second.first, it->second.second), makeLine(x, y)};
+		}
+	}
+
+	DrawCommandPacket WithEndTime(DrawCommandPacket cmd, const float drawEndTime)
+	{
+		cmd.drawEndTime = drawEndTime;
+		return cmd;
+	}
+
+	// Three lines with distinct content hashes that land on the same place of the content index, whatever its size.
+	// The index is at most 2^16 entries for these tests, so equal low 16 bits put them on one probe chain.
+	std::vector<int> FindSameHome()
+	{
+		std::unordered_map<uint32_t, std::vector<int>> homes;
+		for (int id = 0;; id++)
+		{
+			std::vector<int> &ids = homes[DrawCommandStore::HashContent(0, MakeLine(id, 10.0f)) & 0xFFFF];
+			ids.push_back(id);
+			if (ids.size() == 3)
+				return ids;
+		}
+	}
+
+	// A command whose hash collides with a stored one is stored on its own, and neither extends the other.
+	void TestHashCollision()
+	{
+		const auto [a, b] = FindHashCollision();
+		CHECK(DrawCommandStore::HashContent(0, a) == DrawCommandStore::HashContent(0, b));
+
+		DrawCommandStore                  store(8, true);
+		const DrawCommandStore::SlotIndex slotA = store.Insert(0, WithEndTime(a, 10.0f));
+		const DrawCommandStore::SlotIndex slotB = store.Insert(0, WithEndTime(b, 20.0f));
+		CHECK(slotA != slotB);
+		CHECK(store.GetSize() == 2 && store.GetDuplicateCount() == 0);
+		CHECK(store.Get(slotA).drawEndTime == 10.0f);
+
+		// The index now points the hash at b, which is still deduplicated.
+		CHECK(store.Insert(0, WithEndTime(b, 30.0f)) == slotB);
+		CHECK(store.Get(slotB).drawEndTime == 30.0f);
+		CHECK(store.GetDuplicateCount() == 1);
+
+		// a is no longer found by content, so sending it again stores a copy rather than touching b.
+		const DrawCommandStore::SlotIndex copyA = store.Insert(0, WithEndTime(a, 40.0f));
+		CHECK(copyA != slotA && copyA != slotB);
+		CHECK(store.GetSize() == 3 && store.GetDuplicateCount() == 1);
+		CHECK(store.Get(slotB).drawEndTime == 30.0f);
+
+		CHECK(store.RemoveExpired(10.0f) == 1);
+		CHECK(store.RemoveExpired(40.0f) == 2);
+	}
+
+	// Removing a command from the middle of a probe chain shifts the ones after it back, so they are still found.
+	void TestProbeChainErase()
+	{
+		const std::vector<int> ids = FindSameHome();
+
+		DrawCommandStore                         store(8, true);
+		std::vector<DrawCommandStore::SlotIndex> slots;
+		for (const int id : ids)
+		{
+			slots.push_back(store.Insert(0, MakeLine(id, 10.0f)));
+		}
+		CHECK(store.GetDuplicateCount() == 0);
+
+		store.Remove(slots[1]);
+		CHECK(store.Insert(0, MakeLine(ids[2], 20.0f)) == slots[2]);
+		CHECK(store.Insert(0, MakeLine(ids[0], 20.0f)) == slots[0]);
+		CHECK(store.GetDuplicateCount() == 2);
+
+		// The removed one is gone from the index too.
+		store.Insert(0, MakeLine(ids[1], 20.0f));
+		CHECK(store.GetDuplicateCount() == 2 && store.GetSize() == 3);
+
+		// Removing the head of the chain leaves the rest reachable as well.
+		store.Remove(slots[0]);
+		CHECK(store.Insert(0, MakeLine(ids[2], 30.0f)) == slots[2]);
+		CHECK(store.GetDuplicateCount() == 3);
+	}
+
+	// Sending a stored timed command again extends its end time instead of adding a second slot.
+	void TestDuplicateExtends()
+	{
+		DrawCommandStore                  store(8, true);
+		const DrawCommandStore::SlotIndex slot = store.Insert(0, MakeLine(0, 5.0f));
+		CHECK(store.Insert(0, MakeLine(0, 9.0f)) == slot);
+
+		CHECK(store.GetSize() == 1);
+		CHECK(store.Get(slot).drawEndTime == 9.0f);
+		CHECK(store.GetInsertCount() == 1 && store.GetDuplicateCount() == 1);
+		CHECK(store.RemoveExpired(5.0f) == 0);
+
+		// The same line in another channel is a command of its own.
+		CHECK(store.Insert(1, MakeLine(0, 9.0f)) != slot);
+		CHECK(store.GetSize() == 2 && store.GetDuplicateCount() == 1);
+
+		CHECK(store.RemoveExpired(9.0f) == 2);
+		CHECK(store.IsEmpty());
+	}
+}
+
+int main()
+{
+	TestEvictionOrder(false);
+	TestEvictionOrder(true);
+	TestSlotReuse();
+	TestTransientLifetime();
+	TestStaleExpiryEntries();
+	TestExpiryHeapCompaction();
+	TestHashCollision();
+	TestProbeChainErase();
+	TestDuplicateExtends();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "SharedMemoryClient.h"
+#include "TestSupport.h"
+
+namespace
+{
+	constexpr int ROUND_COUNT = 200;
+
+	// Sends one round of packets of many different sizes, after clearing what the last one drew. Each round fills
+	// most of the small ring, so over all rounds a hundred or more packets run across its end: line batches of up to
+	// ten KB, and compact triangles and texts whose odd sizes keep shifting where the next packet starts.
+	// Returns the number of primitives the round draws.
+	size_t SendRound(TestServer &server, std::mt19937 &random)
+	{
+		server.Send(PacketType::CLEAR_ALL_DRAWINGS, nullptr, 0);
+
+		size_t                 count = 0;
+		float                  next  = 0.0f; // Keeps every primitive distinct, so none of them are deduplicated
+		std::vector<std::byte> packet;
+		for (int i = 0; i < 40; i++)
+		{
+			switch (random() % 4)
+			{
+				case 0:
+				case 1:
+				{
+					const DrawBatchHeader batch = {DrawCommandType::LINE, RED, 100.0f, DrawBatchLayout::LIST, static_cast<uint32_t>(1 + random() % 400)};
+					packet.resize(sizeof(batch) + batch.count * sizeof(LineCommandData));
+					memcpy(packet.data(), &batch, sizeof(batch));
+					for (uint32_t j = 0; j < batch.count; j++)
+					{
+						const LineCommandData line({next, 1, 2}, {next, 3, 4});
+						memcpy(packet.data() + sizeof(batch) + j * sizeof(line), &line, sizeof(line));
+						next += 1.0f;
+					}
+					server.Send(PacketType::DRAW_BATCH, packet.data(), static_cast<uint32_t>(packet.size()));
+					count += batch.count;
+					break;
+				}
+				case 2:
+				{
+					const DrawCommandPacket triangle(DrawCommandType::TRIANGLE, BLUE, 100.0f, TriangleCommandData({next, 0, 0}, {0, next, 0}, {0, 0, next}));
+					next += 1.0f;
+					packet.resize(MAX_COMPACT_DRAW_COMMAND_SIZE);
+					server.Send(PacketType::DRAW_COMMAND_COMPACT, packet.data(), static_cast<uint32_t>(EncodeCompactDrawCommand(triangle, packet.data())));
+					count++;
+					break;
+				}
+				default:
+				{
+					std::array<char, 64> text;
+					snprintf(text.data(), text.size(), "%.*s %d", static_cast<int>(random() % 40), "wrapped text wrapped text wrapped text wrapped", i);
+					const DrawCommandPacket command(DrawCommandType::TEXT, GREEN, 100.0f, TextCommandData({next, 5, 6}, text.data()));
+					next += 1.0f;
+					packet.resize(MAX_COMPACT_DRAW_COMMAND_SIZE);
+					server.Send(PacketType::DRAW_COMMAND_COMPACT, packet.data(), static_cast<uint32_t>(EncodeCompactDrawCommand(command, packet.data())));
+					count++;
+					break;
+				}
+			}
+
+			if (i % 8 == 0)
+			{
+				server.Signal();
+			}
+		}
+		return count;
+	}
+
+	size_t GetCount(const DrawList &list)
+	{
+		return list.lines.GetCount() + list.triangles.GetCount() + list.worldTexts.GetCount();
+	}
+
+	struct Result
+	{
+		std::vector<DrawList> rounds;
+		size_t                wrapped = 0;
+	};
+
+	// Runs the rounds through a client with the given transport and returns the draw list it ended up with after each.
+	Result Run(const uint64_t features, const bool mirrored)
+	{
+		TestServer server(SHARED_MEM_MIN_BUFFER_SIZE, features);
+
+		std::atomic<bool>  running = true;
+		SharedMemoryClient client;
+		auto               transport = CreateSharedMemoryTransport(mirrored);
+		const auto        *opened    = transport.get();
+		CHECK(client.Start(running, std::move(transport)));
+		CHECK(opened->IsMirrored() == mirrored);
+
+		Result       result;
+		std::mt19937 random(1234);
+		for (int round = 0; round < ROUND_COUNT; round++)
+		{
+			const size_t count = SendRound(server, random);
+			CHECK(server.WaitUntilDrained());
+			CHECK(WaitFor([&] { return GetCount(client.GetDrawCommands().commands) == count; }));
+			result.rounds.push_back(client.GetDrawCommands().commands);
+		}
+
+		result.wrapped = server.GetWrappedCount();
+		client.Stop();
+		return result;
+	}
+
+	void TestSameAsSingleView(const uint64_t features)
+	{
+		const Result mirrored = Run(features, true);
+		const Result single   = Run(features, false);
+
+		// The stream is the same both times, so it wrapped the same packets both times.
+		CHECK(mirrored.wrapped == single.wrapped);
+		CHECK(mirrored.wrapped >= 100);
+
+		for (int round = 0; round < ROUND_COUNT; round++)
+		{
+			CHECK(IsSameList(mirrored.rounds[round], single.rounds[round]));
+		}
+	}
+}
+
+int main()
+{
+	TestSameAsSingleView(SHARED_MEM_SUPPORTED_FEATURES & ~SharedMemFeature::CHECKED_FRAMING);
+	TestSameAsSingleView(SHARED_MEM_SUPPORTED_FEATURES);
+	return EXIT_SUCCESS;
+}
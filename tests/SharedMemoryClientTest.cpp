@@ -0,0 +1,95 @@
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include "SharedMemoryClient.h"
+#include "TestSupport.h"
+
+namespace
+{
+	// Streams many times the ring size worth of lines through it and checks the client got all of them, in order.
+	void TestStream(const uint64_t features)
+	{
+		TestServer server(SHARED_MEM_MIN_BUFFER_SIZE, features);
+
+		std::atomic<bool>  running = true;
+		SharedMemoryClient client;
+		CHECK(client.Start(running));
+
+		constexpr int COUNT = 15000;
+		static_assert(COUNT <= Config::MAX_DRAW_COMMANDS);
+		for (int i = 0; i < COUNT; i++)
+		{
+			const DrawCommandPacket packet(DrawCommandType::LINE, RED, 100.0f, LineCommandData({static_cast<float>(i), 0, 0}, {1, 1, 1}));
+			server.Send(PacketType::DRAW_COMMAND, &packet, sizeof(packet));
+			if (i % 64 == 0)
+			{
+				server.Signal();
+			}
+		}
+		CHECK(server.WaitUntilDrained());
+
+		CHECK(WaitFor([&] { return client.GetDrawCommands().commands.lines.GetCount() == COUNT; }));
+
+		const DrawList &list = client.GetDrawCommands().commands;
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			CHECK(list.lines.points[i * 2].z == static_cast<float>(i)); // Vector::x is raylib's z
+		}
+
+		client.Stop();
+	}
+
+	// Clears the drawings between rounds of texts, so the client starts over with an empty string pool each time,
+	// reusing an earlier one once the snapshots let go of it. Every round must still read its own strings.
+	void TestClearReusesStringPool()
+	{
+		TestServer server(SHARED_MEM_BUFFER_SIZE);
+
+		std::atomic<bool>  running = true;
+		SharedMemoryClient client;
+		CHECK(client.Start(running));
+
+		uint64_t generation = 0;
+		for (int round = 0; round < 20; round++)
+		{
+			server.Send(PacketType::CLEAR_ALL_DRAWINGS, nullptr, 0);
+
+			constexpr int COUNT = 100;
+			for (int i = 0; i < COUNT; i++)
+			{
+				std::array<char, 32> label;
+				snprintf(label.data(), label.size(), "round %d label %d", round, i);
+				const DrawCommandPacket packet(DrawCommandType::TEXT, WHITE, 100.0f, TextCommandData({static_cast<float>(i), 0, 0}, label.data()));
+				server.Send(PacketType::DRAW_COMMAND, &packet, sizeof(packet));
+			}
+			CHECK(server.WaitUntilDrained());
+
+			CHECK(WaitFor([&]
+			{
+				const DrawList &list = client.GetDrawCommands().commands;
+				return list.worldTexts.GetCount() == COUNT && list.strings->GetGeneration() != generation;
+			}));
+
+			const DrawList &list = client.GetDrawCommands().commands;
+			generation           = list.strings->GetGeneration();
+			CHECK(list.strings->GetCount() == COUNT);
+			for (size_t i = 0; i < COUNT; i++)
+			{
+				std::array<char, 32> label;
+				snprintf(label.data(), label.size(), "round %d label %zu", round, i);
+				CHECK(std::strcmp(list.GetText(list.worldTexts.stringIds[i]), label.data()) == 0);
+			}
+		}
+
+		client.Stop();
+	}
+}
+
+int main()
+{
+	TestStream(SHARED_MEM_SUPPORTED_FEATURES & ~SharedMemFeature::CHECKED_FRAMING);
+	TestStream(SHARED_MEM_SUPPORTED_FEATURES);
+	TestClearReusesStringPool();
+	return EXIT_SUCCESS;
+}
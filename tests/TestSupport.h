@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "DrawList.h"
+#include "SharedDefs.h"
+
+// Fails the test with the expression and where it is, the tests have no framework of their own.
+#define CHECK(expression)                                                                         \
+	do                                                                                            \
+	{                                                                                             \
+		if (!(expression))                                                                        \
+		{                                                                                         \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expression); \
+			std::exit(EXIT_FAILURE);                                                              \
+		}                                                                                         \
+	} while (false)
+
+// Polls condition until it holds or the timeout expires. Returns whether it held.
+inline bool WaitFor(const std::function<bool()> &condition, const std::chrono::milliseconds timeout = std::chrono::seconds(5))
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!condition())
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	return true;
+}
+
+template <typename T>
+bool IsSameArray(const std::vector<T> &a, const std::vector<T> &b)
+{
+	return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+template <typename TTexts>
+bool IsSameTexts(const DrawList &listA, const TTexts &a, const DrawList &listB, const TTexts &b)
+{
+	if (!IsSameArray(a.positions, b.positions) || !IsSameArray(a.colors, b.colors) || a.stringIds.size() != b.stringIds.size())
+		return false;
+	for (size_t i = 0; i < a.stringIds.size(); i++)
+	{
+		if (std::strcmp(listA.GetText(a.stringIds[i]), listB.GetText(b.stringIds[i])) != 0)
+			return false;
+	}
+	return true;
+}
+
+// Whether the lists hold the same primitives in the same order, comparing texts by their string rather than its id.
+inline bool IsSameList(const DrawList &a, const DrawList &b)
+{
+	return IsSameArray(a.lines.points, b.lines.points) && IsSameArray(a.lines.colors, b.lines.colors) &&
+	       IsSameArray(a.triangles.points, b.triangles.points) && IsSameArray(a.triangles.colors, b.triangles.colors) &&
+	       IsSameArray(a.spheres.centers, b.spheres.centers) && IsSameArray(a.spheres.radii, b.spheres.radii) &&
+	       IsSameArray(a.spheres.colors, b.spheres.colors) &&
+	       IsSameArray(a.circles.centers, b.circles.centers) && IsSameArray(a.circles.radii, b.circles.radii) &&
+	       IsSameArray(a.circles.rotationAxes, b.circles.rotationAxes) && IsSameArray(a.circles.rotationAngles, b.circles.rotationAngles) &&
+	       IsSameArray(a.circles.colors, b.circles.colors) &&
+	       IsSameArray(a.boxes.mins, b.boxes.mins) && IsSameArray(a.boxes.maxs, b.boxes.maxs) && IsSameArray(a.boxes.colors, b.boxes.colors) &&
+	       IsSameTexts(a, a.worldTexts, b, b.worldTexts) && IsSameTexts(a, a.screenTexts, b, b.screenTexts);
+}
+
+// The server half of the protocol, just enough of it to drive a SharedMemoryClient in the same process.
+// Creates the POSIX shared memory object the client opens and writes packets into its ring.
+class TestServer
+{
+public:
+	explicit TestServer(const size_t capacity, const uint64_t features = SHARED_MEM_SUPPORTED_FEATURES)
+		: m_capacity(capacity)
+	{
+		shm_unlink(SHARED_MEM_POSIX_NAME);
+		const int fd = shm_open(SHARED_MEM_POSIX_NAME, O_CREAT | O_RDWR, 0600);
+		CHECK(fd >= 0);
+		CHECK(ftruncate(fd, static_cast<off_t>(GetSharedMemorySize(capacity))) == 0);
+
+		void *view = mmap(nullptr, GetSharedMemorySize(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		CHECK(view != MAP_FAILED);
+
+		m_layout           = static_cast<SharedMemoryLayout*>(view);
+		m_layout->version  = SHARED_MEM_PROTOCOL_VERSION;
+		m_layout->capacity = capacity;
+		m_layout->features = features;
+		std::atomic_ref(m_layout->magic).store(SHARED_MEM_MAGIC, std::memory_order_release);
+	}
+
+	~TestServer()
+	{
+		munmap(m_layout, GetSharedMemorySize(m_capacity));
+		shm_unlink(SHARED_MEM_POSIX_NAME);
+	}
+
+	TestServer(const TestServer &other)                = delete;
+	TestServer(TestServer &&other) noexcept            = delete;
+	TestServer &operator=(const TestServer &other)     = delete;
+	TestServer &operator=(TestServer &&other) noexcept = delete;
+
+	// Writes one packet, framed if the server uses SharedMemFeature::CHECKED_FRAMING, waiting for room first.
+	void Send(const PacketType type, const void *data, const uint32_t size)
+	{
+		const auto *bytes = static_cast<const std::byte*>(data);
+		if ((m_layout->features & SharedMemFeature::CHECKED_FRAMING) != 0)
+		{
+			const FramedPacketHeader header = {SHARED_MEM_SYNC_WORD, type, size, ComputePacketChecksum(type, size, bytes)};
+			SendRaw({&header, sizeof(header)}, {data, size});
+		}
+		else
+		{
+			const PacketHeader header = {type, size};
+			SendRaw({&header, sizeof(header)}, {data, size});
+		}
+	}
+
+	struct Span
+	{
+		const void *data;
+		size_t      size;
+	};
+
+	// Writes the bytes as they are and publishes them as one, for tests that corrupt the framing themselves.
+	void SendRaw(const Span first, const Span second = {nullptr, 0})
+	{
+		const size_t size = first.size + second.size;
+		CHECK(size < m_capacity);
+
+		std::atomic_ref tail(m_layout->tail);
+		const size_t    head = m_layout->head;
+		while (((head - tail.load(std::memory_order_acquire)) & (m_capacity - 1)) + size >= m_capacity - 1)
+		{
+			Signal();
+			std::this_thread::yield();
+		}
+
+		if ((head & (m_capacity - 1)) + size > m_capacity)
+		{
+			m_wrapped++;
+		}
+
+		Write(head, first);
+		Write(head + first.size, second);
+		std::atomic_ref(m_layout->head).store((head + size) & (m_capacity - 1), std::memory_order_release);
+	}
+
+	// Wakes the client if it is blocked, as the server does once per tick.
+	void Signal()
+	{
+		if (!ShouldSignalClient(*m_layout))
+			return;
+		std::atomic_ref(m_layout->signal).fetch_add(1, std::memory_order_seq_cst);
+		syscall(SYS_futex, &m_layout->signal, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+	}
+
+	// Signals the client and waits until it has consumed everything written so far.
+	bool WaitUntilDrained()
+	{
+		Signal();
+		return WaitFor([this]
+		{
+			return std::atomic_ref(m_layout->tail).load(std::memory_order_acquire) == std::atomic_ref(m_layout->head).load(std::memory_order_acquire);
+		});
+	}
+
+	[[nodiscard]] SharedMemoryLayout &GetLayout() const { return *m_layout; }
+	[[nodiscard]] size_t              GetCapacity() const { return m_capacity; }
+	[[nodiscard]] size_t              GetWrappedCount() const { return m_wrapped; } // Packets written across the end of the buffer
+
+private:
+	void Write(const size_t offset, const Span bytes)
+	{
+		std::byte   *buffer = m_layout->GetBuffer();
+		const size_t start  = offset & (m_capacity - 1);
+		const size_t first  = std::min(bytes.size, m_capacity - start);
+		if (bytes.size != 0)
+		{
+			memcpy(buffer + start, bytes.data, first);
+			memcpy(buffer, static_cast<const std::byte*>(bytes.data) + first, bytes.size - first);
+		}
+	}
+
+	SharedMemoryLayout *m_layout   = nullptr;
+	size_t              m_capacity = 0;
+	size_t              m_wrapped  = 0;
+};